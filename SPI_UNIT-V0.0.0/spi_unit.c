@@ -20,10 +20,100 @@
 
 #include "spi_unit.h"
 
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+/* ------ Register images of a configuration ------ */
+#define __SPI_SPCR_IMAGE(cfg) (((uint8_t)(cfg)->FirstBit << DORD) | ((uint8_t)(cfg)->Mode << MSTR) | ((uint8_t)(cfg)->ClockPolarity << CPOL) | ((uint8_t)(cfg)->ClockPhase << CPHA) | ((uint8_t)(cfg)->ClockFrequency & _SPI_2_BIT_SET))
+#define __SPI_SPSR_IMAGE(cfg) (((uint8_t)(cfg)->ClockFrequency >> _SPI2X_SHIFT) & _SPI_1_BIT_SET)
+
+#define _SPI_CFG_INVALID      0xFF                          /* Cache value that never matches an image */
+#define _SPI_SPCR_RUN_BITS    ((1U << SPE) | (1U << SPIE))  /* SPCR bits that are not part of a configuration */
+
+/* ------ Wait for the end of a byte transfer ------ */
+#define _SPI_WAIT_POLLS  1024U /* SPIF polls before the timeout delay (a byte at F_CPU/128 is 1024 cycles) */
+
+/* ------ Memory index of a word byte on the bus (AVR is little endian) ------ */
+#define __SPI_WORD_INDEX(_byte, _word_size, _order) (((_order) == _SPI_BYTEORDER_MSB) ? ((_word_size) - 1 - (_byte)) : (_byte))
+
+/* ------ SPI clock gating ------ */
+#ifdef PRSPI
+	
+	#if defined(PRR0)   /* ATmega644P, ATmega1284P, ... */
+		#define _SPI_PRR PRR0
+	#elif defined(PRR)
+		#define _SPI_PRR PRR
+	#endif
+	
+#endif /* PRSPI */
+
+#ifdef _SPI_PRR
+	
+	#define __SPI_CLOCK_ON  {_SPI_PRR &= ~(1U << PRSPI);}
+	#define __SPI_CLOCK_OFF {_SPI_PRR |= (1U << PRSPI);}
+	
+#else
+	
+	#define __SPI_CLOCK_ON
+	#define __SPI_CLOCK_OFF {SPCR &= ~(1U << SPE);}
+	
+#endif /* _SPI_PRR */
+
+/* ------ Automatic power management ------ */
+#if (_SPI_POWER_SAVE == 1)
+	
+	#define __SPI_AUTO_POWER_UP   {SPI_PowerUp();}
+	#define __SPI_AUTO_POWER_DOWN {SPI_PowerDown();}
+	
+#else
+	
+	#define __SPI_AUTO_POWER_UP
+	#define __SPI_AUTO_POWER_DOWN
+	
+#endif /* _SPI_POWER_SAVE */
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Variable ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 static volatile uint8_t  *g_spi_txdata_it   = 0;
 static volatile uint8_t  *g_spi_rxdata_it   = 0;
 static volatile uint16_t g_spi_data_size_it = 0;
+static volatile uint8_t  g_spi_busy_it      = 0;
+static volatile uint8_t  g_spi_error_it     = 0;
+
+static volatile uint8_t g_spi_spcr_cfg = _SPI_CFG_INVALID; /* Also changed by the scheduler interrupt */
+static volatile uint8_t g_spi_spsr_cfg = _SPI_CFG_INVALID;
+
+static volatile uint8_t g_spi_power_down = 0;
+static volatile uint8_t g_spi_spcr_run   = 0;
+
+static SPI_TransactionTypeDef *volatile g_spi_sched_head[_SPI_LANE_COUNT];
+static SPI_TransactionTypeDef *volatile g_spi_sched_tail[_SPI_LANE_COUNT];
+static SPI_TransactionTypeDef *volatile g_spi_sched_current = 0;
+static SPI_DeviceTypeDef      *volatile g_spi_sched_device  = 0;
+static SPI_LaneStatTypeDef             g_spi_sched_stat[_SPI_LANE_COUNT];
+
+static volatile uint8_t  *g_spi_pixel_line_it  = 0;
+static volatile uint16_t g_spi_pixel_stride_it = 0;
+static volatile uint16_t g_spi_pixel_width_it  = 0;
+static volatile uint16_t g_spi_pixel_col_it    = 0;
+static volatile uint16_t g_spi_pixel_rows_it   = 0;
+static volatile uint16_t g_spi_pixel_color_it  = 0;
+static volatile uint32_t g_spi_pixel_count_it  = 0;
+static volatile uint8_t  g_spi_pixel_phase_it  = 0;
+
+static volatile uint8_t  g_spi_word_size_it   = 0;
+static volatile uint8_t  g_spi_word_order_it  = 0;
+static volatile uint8_t  g_spi_word_byte_it   = 0;
+
+static SPI_ChainTypeDef *volatile g_spi_chain_it = 0;
+
+static SPI_FrameTypeDef *volatile g_spi_frame_it = 0;
+static volatile uint16_t g_spi_frame_size_it  = 0;
+static volatile uint8_t  g_spi_frame_count_it = 0;
+static volatile uint8_t  g_spi_frame_write_it = 0; /* Changed by the SS interrupt only */
+static volatile uint8_t  g_spi_frame_read_it  = 0; /* Changed by the application only */
+
+static volatile uint8_t  *g_spi_regmap_it       = 0;
+static volatile uint8_t  g_spi_regmap_size_it   = 0;
+static volatile uint8_t  g_spi_regmap_index_it  = 0;
+static volatile uint8_t  g_spi_regmap_state_it  = 0;
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Enum ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 enum /* Bit set enum */
@@ -41,8 +131,43 @@ enum /* Bit shift enum */
 	
 }SPI_BitShift;
 
+enum /* Register map state enum */
+{
+	
+	_SPI_REGMAP_ADDRESS = 0,
+	_SPI_REGMAP_READ    = 1U,
+	_SPI_REGMAP_WRITE   = 2U
+	
+}SPI_RegMapState;
+
+enum /* Dummy data enum */
+{
+	
+	_SPI_DUMMY_BYTE = 0xFF
+	
+}SPI_Dummy;
+
+enum /* Pixel byte enum */
+{
+	
+	_SPI_PIXEL_HIGH = 0,
+	_SPI_PIXEL_LOW  = 1U,
+	_SPI_PIXEL_END  = 2U,
+	
+	_SPI_PIXEL_SIZE = 3U /* Bytes of a RGB888 pixel */
+	
+}SPI_PixelByte;
+
+enum /* Word memory enum */
+{
+	
+	_SPI_WORD_16BIT_MEMORY = 2U, /* uint16_t */
+	_SPI_WORD_32BIT_MEMORY = 4U  /* uint32_t */
+	
+}SPI_WordMemory;
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Prototypes ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-void (*SPI_DataControl_IT)(void);
+void SPI_DataControl_IT_Idle(void);
 
 void SPI_DataControl_IT_Transmit(void);
 
@@ -50,24 +175,70 @@ void SPI_DataControl_IT_Receive(void);
 
 void SPI_DataControl_IT_TransmitReceive(void);
 
+void SPI_DataControl_IT_SlaveRegMap(void);
+
+void SPI_DataControl_IT_SlaveFrame(void);
+
+void SPI_DataControl_IT_Pixels(void);
+
+void SPI_DataControl_IT_FillColor(void);
+
+static uint8_t SPI_Pixel_Load_IT(void);
+
+void SPI_DataControl_IT_Word(void);
+
+void SPI_DataControl_IT_Chain(void);
+
+void SPI_DataControl_IT_Schedule(void);
+
+static void SPI_Schedule_Next(void);
+
+static void SPI_Schedule_Done(SPI_TransactionTypeDef *_trans);
+
+static uint8_t SPI_WaitTransfer(uint32_t _timeout);
+
+static uint8_t SPI_GlobalIT_Lock(void);
+
+static uint8_t SPI_Busy_Claim_IT(void);
+
+static void SPI_Transfer_Done_IT(void);
+
+static void SPI_Transfer_Abort_IT(SPI_ErrorTypeDef _error);
+
+void (*SPI_DataControl_IT)(void) = SPI_DataControl_IT_Idle; /* Spurious interrupts are ignored */
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Interrupt control ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 _INTERRUPT(_SPI_IT_VECT)
 {
 	
-	SPI_DataControl_IT();
-	SPI_TxCpltCallback();
+	/* Master mode is lost (MODF): SS pin is driven low by another master */
+	if ((g_spi_busy_it != 0) && ((SPCR & (1U << MSTR)) == 0) && ((g_spi_spcr_cfg & (1U << MSTR)) != 0) && (g_spi_spcr_cfg != _SPI_CFG_INVALID))
+	{
+		SPI_Transfer_Abort_IT(_SPI_ERROR_MODF);
+	}
+	else
+	{
+		SPI_DataControl_IT(); /* The data controls call SPI_TxCpltCallback() themselves */
+	}
 	
 }
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Function ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 void SPI_Init(SPI_InitTypeDef *_spi_cfg)
 {
+	/* Registers are not written while the SPI clock is stopped */
+	__SPI_CLOCK_ON
+	g_spi_power_down = 0;
+	
 	/* Set MOSI and SCK output, all others input */
 	_DDR_SPI = (1 << _MOSI_PIN) | (1 << _SCK_PIN);
 	
 	/* Initialize spi */
-	SPCR  = ((uint8_t)_spi_cfg->FirstBit << DORD) | ((uint8_t)_spi_cfg->Mode << MSTR) | ((uint8_t)_spi_cfg->ClockPolarity << CPOL) | ((uint8_t)_spi_cfg->ClockPhase << CPHA) | ((uint8_t)_spi_cfg->ClockFrequency & _SPI_2_BIT_SET);
-	SPSR |= ((uint8_t)_spi_cfg->ClockFrequency >> _SPI2X_SHIFT) & _SPI_1_BIT_SET; 
+	g_spi_spcr_cfg = __SPI_SPCR_IMAGE(_spi_cfg);
+	g_spi_spsr_cfg = __SPI_SPSR_IMAGE(_spi_cfg);
+	
+	SPCR = g_spi_spcr_cfg;
+	SPSR = g_spi_spsr_cfg; /* Also clear a stale SPI2X */
 	
 }
 /*
@@ -95,11 +266,130 @@ void SPI_Init(SPI_InitTypeDef *_spi_cfg)
 			
 */
 
+void SPI_ReConfig(SPI_InitTypeDef *_spi_cfg)
+{
+	
+	uint8_t spcr_image = __SPI_SPCR_IMAGE(_spi_cfg);
+	uint8_t spsr_image = __SPI_SPSR_IMAGE(_spi_cfg);
+	
+	if (g_spi_power_down) /* Registers are restored by SPI_PowerUp */
+	{
+		
+		g_spi_spcr_cfg = spcr_image;
+		g_spi_spsr_cfg = spsr_image;
+		
+		return;
+		
+	}
+	
+	/* Write only the changed registers */
+	if (spcr_image != g_spi_spcr_cfg)
+	{
+		
+		SPCR = (SPCR & _SPI_SPCR_RUN_BITS) | spcr_image; /* Keep enable bits */
+		g_spi_spcr_cfg = spcr_image;
+		
+	}
+	
+	if (spsr_image != g_spi_spsr_cfg)
+	{
+		
+		SPSR = spsr_image;
+		g_spi_spsr_cfg = spsr_image;
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Change the SPI configuration without disabling it. The last applied
+									configuration is cached and only the changed registers are written.
+									The SPI pins direction is not changed (set it by SPI_Init).
+									In power down, the configuration is applied by SPI_PowerUp.
+									Do not call it while scheduled transactions (SPI_Schedule_IT) are
+									queued or running, the scheduler applies the device configuration.
+			
+			Parameters
+									* _spi_cfg : pointer to a SPI_InitTypeDef structure that contains
+												 the configuration information for SPI module.
+									
+			Return Values
+									-
+			
+	Example :
+			SPI_InitTypeDef flash_cfg;
+			SPI_InitTypeDef adc_cfg;
+			
+			SPI_Init(&flash_cfg);
+			__SPI_ENABLE
+			
+			SPI_ReConfig(&adc_cfg);
+			SPI_TransmitReceive(adc_cmd, adc_data, 3, 100);
+			
+			SPI_ReConfig(&flash_cfg);
+			SPI_Transmit(flash_cmd, 4, 100);
+			
+*/
+
+SPI_CLKRateTypeDef SPI_GetClockRate(uint32_t _max_freq)
+{
+	
+	return __SPI_CLOCKRATE_SELECT(_max_freq);
+	
+}
+/*
+	Guide   :
+			Function description	Find the fastest SPI clock rate that does not exceed the maximum
+									frequency of the device (without division).
+			
+			Parameters
+									* _max_freq : maximum SPI clock frequency of the device in Hz
+									
+			Return Values
+									* SPI_CLKRateTypeDef value (_SPI_CLOCKRATE_FCPU_128 if _max_freq
+									  is lower than F_CPU/128)
+			
+	Example :
+			
+			spi_cfg.ClockFrequency = SPI_GetClockRate(device_max_freq);
+			
+*/
+
+uint32_t SPI_GetClockFrequency(SPI_CLKRateTypeDef _rate)
+{
+	
+	return __SPI_CLOCKRATE_FREQ(_rate);
+	
+}
+/*
+	Guide   :
+			Function description	Get the SPI clock frequency of a clock rate.
+			
+			Parameters
+									* _rate : SPI_CLKRateTypeDef value
+									
+			Return Values
+									* SPI clock frequency in Hz
+			
+	Example :
+			
+			uint32_t achieved_freq = SPI_GetClockFrequency(spi_cfg.ClockFrequency);
+			
+*/
+
 void SPI_DeInit(void)
 {
 	
+	/* Registers are not written while the SPI clock is stopped */
+	__SPI_CLOCK_ON
+	g_spi_power_down = 0;
+	
 	SPCR  = 0;
 	
+	/* ------------------------ */
+	g_spi_spcr_cfg = 0;
+	g_spi_spcr_run = 0;
+	
 }
 /*
 	Guide   :
@@ -119,11 +409,20 @@ void SPI_DeInit(void)
 
 void SPI_DefaultMasterInit(void)
 {
+	/* Registers are not written while the SPI clock is stopped */
+	__SPI_CLOCK_ON
+	g_spi_power_down = 0;
+	
 	/* Set MOSI and SCK output, all others input */
 	_DDR_SPI = (1 << _MOSI_PIN) | (1 << _SCK_PIN);
 	
 	/* Enable SPI, Master, set clock rate fcpu/16 */
 	SPCR = (1 << SPE) | (1 << MSTR) | (1 << SPR0);
+	SPSR = 0;
+	
+	/* ------------------------ */
+	g_spi_spcr_cfg = (1 << MSTR) | (1 << SPR0);
+	g_spi_spsr_cfg = 0;
 	
 }
 /*
@@ -145,11 +444,20 @@ void SPI_DefaultMasterInit(void)
 
 void SPI_DefaultSlaveInit(void)
 {
+	/* Registers are not written while the SPI clock is stopped */
+	__SPI_CLOCK_ON
+	g_spi_power_down = 0;
+	
 	/* Set MOSI and SCK output, all others input */
 	_DDR_SPI = (1 << _MISO_PIN);
 	
 	/* Enable SPI, Master, set clock rate fcpu/16 */
 	SPCR = (1 << SPE);
+	SPSR = 0;
+	
+	/* ------------------------ */
+	g_spi_spcr_cfg = 0;
+	g_spi_spsr_cfg = 0;
 	
 }
 /*
@@ -172,6 +480,8 @@ void SPI_DefaultSlaveInit(void)
 void SPI_Transmit(uint8_t *_pdata, uint16_t _size, uint32_t _timeout)
 {
 	
+	__SPI_AUTO_POWER_UP
+	
 	for (; _size > 0; _size--) /* Copy data loop */
 	{
 		/* Start transmission */
@@ -188,6 +498,8 @@ void SPI_Transmit(uint8_t *_pdata, uint16_t _size, uint32_t _timeout)
 		
 	}
 	
+	__SPI_AUTO_POWER_DOWN
+	
 }
 /*
 	Guide   :
@@ -210,8 +522,10 @@ void SPI_Transmit(uint8_t *_pdata, uint16_t _size, uint32_t _timeout)
 void SPI_Transmit_IT(uint8_t *_pdata, uint16_t _size)
 {
 	
-	if (g_spi_data_size_it == 0)
+	if ((_size > 0) && (SPI_Busy_Claim_IT() != 0))
 	{
+		__SPI_AUTO_POWER_UP
+		
 		SPI_DataControl_IT = SPI_DataControl_IT_Transmit;
 		
 		/* ------------------------ */
@@ -221,6 +535,11 @@ void SPI_Transmit_IT(uint8_t *_pdata, uint16_t _size)
 		/* Start transmission */
 		SPDR = *_pdata;
 		
+		if (SPSR & (1U << WCOL)) /* Transfer in progress, data is not written */
+		{
+			SPI_Transfer_Abort_IT(_SPI_ERROR_WCOL);
+		}
+		
 	}
 	
 }
@@ -246,6 +565,8 @@ void SPI_Transmit_IT(uint8_t *_pdata, uint16_t _size)
 void SPI_Receive(uint8_t *_pdata, uint16_t _size, uint32_t _timeout)
 {
 	
+	__SPI_AUTO_POWER_UP
+	
 	for (; _size > 0; _size--) /* Copy data loop */
 	{
 		/* Wait for reception complete */
@@ -260,6 +581,8 @@ void SPI_Receive(uint8_t *_pdata, uint16_t _size, uint32_t _timeout)
 		
 	}
 	
+	__SPI_AUTO_POWER_DOWN
+	
 }
 /*
 	Guide   :
@@ -284,8 +607,10 @@ void SPI_Receive(uint8_t *_pdata, uint16_t _size, uint32_t _timeout)
 void SPI_Receive_IT(uint8_t *_pdata, uint16_t _size)
 {
 	
-	if (g_spi_data_size_it == 0)
+	if ((_size > 0) && (SPI_Busy_Claim_IT() != 0))
 	{
+		__SPI_AUTO_POWER_UP
+		
 		SPI_DataControl_IT = SPI_DataControl_IT_Receive;
 		
 		/* ------------------------ */
@@ -317,6 +642,8 @@ void SPI_Receive_IT(uint8_t *_pdata, uint16_t _size)
 void SPI_TransmitReceive(uint8_t *_tx_data, uint8_t *_rx_data, uint16_t _size, uint32_t _timeout)
 {
 	
+	__SPI_AUTO_POWER_UP
+	
 	for (; _size > 0; _size--)
 	{
 		/* Start transmission */
@@ -336,6 +663,8 @@ void SPI_TransmitReceive(uint8_t *_tx_data, uint8_t *_rx_data, uint16_t _size, u
 		
 	}
 	
+	__SPI_AUTO_POWER_DOWN
+	
 }
 /*
 	Guide   :
@@ -362,8 +691,10 @@ void SPI_TransmitReceive(uint8_t *_tx_data, uint8_t *_rx_data, uint16_t _size, u
 void SPI_TransmitReceive_IT(uint8_t *_tx_data, uint8_t *_rx_data, uint16_t _size)
 {
 	
-	if (g_spi_data_size_it == 0)
+	if ((_size > 0) && (SPI_Busy_Claim_IT() != 0))
 	{
+		__SPI_AUTO_POWER_UP
+		
 		SPI_DataControl_IT = SPI_DataControl_IT_TransmitReceive;
 		
 		/* ------------------------ */
@@ -374,6 +705,11 @@ void SPI_TransmitReceive_IT(uint8_t *_tx_data, uint8_t *_rx_data, uint16_t _size
 		/* Start transmission */
 		SPDR = *_tx_data;
 		
+		if (SPSR & (1U << WCOL)) /* Transfer in progress, data is not written */
+		{
+			SPI_Transfer_Abort_IT(_SPI_ERROR_WCOL);
+		}
+		
 	}
 	
 }
@@ -398,55 +734,1811 @@ void SPI_TransmitReceive_IT(uint8_t *_tx_data, uint8_t *_rx_data, uint16_t _size
 			
 */
 
-/* ............... IT Data Controls ............... */
-
-void SPI_DataControl_IT_Transmit(void)
+void SPI_TransmitPixels(uint8_t *_pdata, uint16_t _width, uint16_t _height, uint16_t _stride, uint32_t _timeout)
 {
 	
-	if (g_spi_data_size_it > 0)
+	uint8_t  *line  = _pdata;
+	uint16_t col    = _width;
+	uint8_t  ready  = 1;
+	uint16_t color;
+	
+	if ((_width == 0) || (_height == 0))
+	{
+		return;
+	}
+	
+	__SPI_AUTO_POWER_UP
+	
+	/* ------------------------ */
+	color = __SPI_RGB565(_pdata[0], _pdata[1], _pdata[2]);
+	
+	for (;;) /* Pixel loop */
 	{
+		/* Start transmission of the high byte */
+		SPDR = (uint8_t)(color >> 8);
 		
-		SPDR = *g_spi_txdata_it;
-		g_spi_txdata_it++;
+		/* Find the next pixel */
+		_pdata += _SPI_PIXEL_SIZE;
+		col--;
 		
-		g_spi_data_size_it--;
+		if (col == 0) /* End of the line */
+		{
+			
+			col    = _width;
+			line  += (uint16_t)(_stride * _SPI_PIXEL_SIZE);
+			_pdata = line;
+			
+			_height--;
+			
+		}
+		
+		/* Wait for transmission complete */
+		ready = SPI_WaitTransfer(_timeout);
 		
+		if (ready == 0) /* Timeout, the transfer is stopped */
+		{
+			break;
+		}
+		
+		/* Start transmission of the low byte */
+		SPDR = (uint8_t)color;
+		
+		if (_height == 0)
+		{
+			break;
+		}
+		
+		/* Convert the next pixel */
+		color = __SPI_RGB565(_pdata[0], _pdata[1], _pdata[2]);
+		
+		/* Wait for transmission complete */
+		ready = SPI_WaitTransfer(_timeout);
+		
+		if (ready == 0)
+		{
+			break;
+		}
+		
+	}
+	
+	/* Wait for transmission complete */
+	if (ready != 0)
+	{
+		SPI_WaitTransfer(_timeout);
 	}
 	
+	__SPI_AUTO_POWER_DOWN
+	
 }
+/*
+	Guide   :
+			Function description	Transmit a window of RGB888 pixels as RGB565 (high byte first) in
+									blocking mode. The next pixel is converted while the current byte
+									is sent, no RGB565 buffer is needed.
+			
+			Parameters
+									* _pdata   : pointer to the first pixel of the window (3 bytes: R, G, B)
+									* _width   : window width in pixels
+									* _height  : window height in pixels
+									* _stride  : source line length in pixels (_width for a line buffer)
+									* _timeout : Timeout duration of each byte (ms), the transfer is
+												 stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t frame[240][320][3];
+			
+			// Dirty rectangle x = 10, y = 20, 50 x 30 pixels (set the display window first)
+			SPI_TransmitPixels(&frame[20][10][0], 50, 30, 320, 10);
+			
+*/
 
-void SPI_DataControl_IT_Receive(void)
+void SPI_TransmitPixels_IT(uint8_t *_pdata, uint16_t _width, uint16_t _height, uint16_t _stride)
 {
 	
-	if (g_spi_data_size_it > 0)
+	if ((_width > 0) && (_height > 0) && (SPI_Busy_Claim_IT() != 0))
 	{
+		__SPI_AUTO_POWER_UP
 		
-		*g_spi_rxdata_it = SPDR;
-		g_spi_rxdata_it++;
+		SPI_DataControl_IT = SPI_DataControl_IT_Pixels;
 		
-		g_spi_data_size_it--;
+		/* ------------------------ */
+		g_spi_txdata_it       = _pdata;
+		g_spi_pixel_line_it   = _pdata;
+		g_spi_pixel_stride_it = _stride * _SPI_PIXEL_SIZE;
+		g_spi_pixel_width_it  = _width;
+		g_spi_pixel_col_it    = _width;
+		g_spi_pixel_rows_it   = _height;
+		g_spi_pixel_phase_it  = _SPI_PIXEL_LOW;
+		
+		SPI_Pixel_Load_IT();
+		
+		/* Start transmission */
+		SPDR = (uint8_t)(g_spi_pixel_color_it >> 8);
+		
+		if (SPSR & (1U << WCOL)) /* Transfer in progress, data is not written */
+		{
+			SPI_Transfer_Abort_IT(_SPI_ERROR_WCOL);
+		}
 		
 	}
 	
 }
+/*
+	Guide   :
+			Function description	Transmit a window of RGB888 pixels as RGB565 (high byte first) in
+									non-blocking mode with Interrupt. The next pixel is converted in the
+									interrupt while the current byte is sent.
+			
+			Parameters
+									* _pdata   : pointer to the first pixel of the window (3 bytes: R, G, B)
+									* _width   : window width in pixels
+									* _height  : window height in pixels
+									* _stride  : source line length in pixels (_width for a line buffer)
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t line[320][3];
+			
+			SPI_TransmitPixels_IT(&line[0][0], 320, 1, 320);
+			
+*/
 
-void SPI_DataControl_IT_TransmitReceive(void)
+void SPI_FillColor(uint16_t _color, uint32_t _count, uint32_t _timeout)
 {
 	
-	if (g_spi_data_size_it > 0)
+	__SPI_AUTO_POWER_UP
+	
+	/* ------------------------ */
+	for (; _count > 0; _count--) /* Pixel loop */
 	{
+		/* Start transmission of the high byte */
+		SPDR = (uint8_t)(_color >> 8);
 		
-		SPDR = *g_spi_txdata_it;
-		*g_spi_rxdata_it = SPDR;
+		/* Wait for transmission complete */
+		if (SPI_WaitTransfer(_timeout) == 0) /* Timeout, the transfer is stopped */
+		{
+			break;
+		}
 		
-		g_spi_txdata_it++;
-		g_spi_rxdata_it++;
-		g_spi_data_size_it--;
+		/* Start transmission of the low byte */
+		SPDR = (uint8_t)_color;
+		
+		/* Wait for transmission complete */
+		if (SPI_WaitTransfer(_timeout) == 0)
+		{
+			break;
+		}
 		
 	}
-	else
-	{
-		*g_spi_rxdata_it = SPDR;
+	
+	__SPI_AUTO_POWER_DOWN
+	
+}
+/*
+	Guide   :
+			Function description	Transmit a RGB565 color (high byte first) repeatedly in blocking mode,
+									for example to fill a rectangle. No source buffer is needed.
+			
+			Parameters
+									* _color   : RGB565 color
+									* _count   : amount of pixels
+									* _timeout : Timeout duration of each byte (ms), the transfer is
+												 stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_FillColor(__SPI_RGB565(255, 0, 0), 320UL * 240UL, 10);
+			
+*/
+
+void SPI_FillColor_IT(uint16_t _color, uint32_t _count)
+{
+	
+	if ((_count > 0) && (SPI_Busy_Claim_IT() != 0))
+	{
+		__SPI_AUTO_POWER_UP
+		
+		SPI_DataControl_IT = SPI_DataControl_IT_FillColor;
+		
+		/* ------------------------ */
+		g_spi_pixel_color_it = _color;
+		g_spi_pixel_count_it = _count - 1;
+		g_spi_pixel_phase_it = _SPI_PIXEL_LOW;
+		
+		/* Start transmission */
+		SPDR = (uint8_t)(_color >> 8);
+		
+		if (SPSR & (1U << WCOL)) /* Transfer in progress, data is not written */
+		{
+			SPI_Transfer_Abort_IT(_SPI_ERROR_WCOL);
+		}
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Transmit a RGB565 color (high byte first) repeatedly in non-blocking
+									mode with Interrupt. No source buffer is needed.
+			
+			Parameters
+									* _color   : RGB565 color
+									* _count   : amount of pixels
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_FillColor_IT(__SPI_RGB565(0, 0, 255), 50UL * 30UL);
+			
+*/
+
+void SPI_TransmitWord(void *_pdata, uint16_t _size, SPI_WordSizeTypeDef _word_size, SPI_ByteOrderTypeDef _order, uint32_t _timeout)
+{
+	
+	SPI_TransmitReceiveWord(_pdata, 0, _size, _word_size, _order, _timeout);
+	
+}
+/*
+	Guide   :
+			Function description	Transmit an amount of 16/24/32-bit words in blocking mode. The words
+									are split into bytes in the transfer loop (no byte buffer is needed).
+			
+			Parameters
+									* _pdata     : pointer to data buffer (uint16_t for 16-bit words,
+												   uint32_t for 24/32-bit words)
+									* _size      : amount of words to be sent
+									* _word_size : _SPI_WORDSIZE_16BIT, _SPI_WORDSIZE_24BIT or _SPI_WORDSIZE_32BIT
+									* _order     : byte order on the bus (_SPI_BYTEORDER_MSB = most significant
+												   byte first, _SPI_BYTEORDER_LSB = least significant byte first)
+									* _timeout   : Timeout duration of each byte (ms), the transfer is
+												   stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint16_t dac_data[32];
+			
+			SPI_TransmitWord(dac_data, 32, _SPI_WORDSIZE_16BIT, _SPI_BYTEORDER_MSB, 10);
+			
+*/
+
+void SPI_TransmitReceiveWord(void *_tx_data, void *_rx_data, uint16_t _size, SPI_WordSizeTypeDef _word_size, SPI_ByteOrderTypeDef _order, uint32_t _timeout)
+{
+	
+	uint8_t *tx_word = (uint8_t *)_tx_data;
+	uint8_t *rx_word = (uint8_t *)_rx_data;
+	uint8_t memory   = (_word_size == _SPI_WORDSIZE_16BIT) ? _SPI_WORD_16BIT_MEMORY : _SPI_WORD_32BIT_MEMORY;
+	uint8_t ready    = 1;
+	uint8_t byte;
+	uint8_t index;
+	
+	__SPI_AUTO_POWER_UP
+	
+	/* ------------------------ */
+	for (; (_size > 0) && (ready != 0); _size--) /* Word loop */
+	{
+		
+		for (byte = 0; byte < _word_size; byte++) /* Byte loop */
+		{
+			
+			index = __SPI_WORD_INDEX(byte, _word_size, _order);
+			
+			/* Start transmission */
+			SPDR = (tx_word != 0) ? tx_word[index] : _SPI_DUMMY_BYTE;
+			
+			/* Wait for transmission complete */
+			ready = SPI_WaitTransfer(_timeout);
+			
+			if (ready == 0) /* Timeout, the transfer is stopped */
+			{
+				break;
+			}
+			
+			/* ------------------------ */
+			if (rx_word != 0)
+			{
+				rx_word[index] = SPDR;
+			}
+			
+		}
+		
+		/* Next word */
+		if (rx_word != 0)
+		{
+			
+			if (_word_size == _SPI_WORDSIZE_24BIT)
+			{
+				rx_word[_SPI_WORDSIZE_24BIT] = 0;
+			}
+			
+			rx_word += memory;
+			
+		}
+		
+		if (tx_word != 0)
+		{
+			tx_word += memory;
+		}
+		
+	}
+	
+	__SPI_AUTO_POWER_DOWN
+	
+}
+/*
+	Guide   :
+			Function description	Transmit and Receive an amount of 16/24/32-bit words in blocking mode.
+									The words are split into bytes and assembled in the transfer loop.
+			
+			Parameters
+									* _tx_data   : pointer to transmission data buffer (0 = send dummy bytes)
+									* _rx_data   : pointer to reception data buffer (0 = discard received data)
+									* _size      : amount of words to be sent and received
+									* _word_size : _SPI_WORDSIZE_16BIT, _SPI_WORDSIZE_24BIT or _SPI_WORDSIZE_32BIT
+									* _order     : byte order on the bus (_SPI_BYTEORDER_MSB or _SPI_BYTEORDER_LSB)
+									* _timeout   : Timeout duration of each byte (ms), the transfer is
+												   stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint32_t adc_data[8]; // 24-bit samples
+			
+			SPI_TransmitReceiveWord(0, adc_data, 8, _SPI_WORDSIZE_24BIT, _SPI_BYTEORDER_MSB, 10);
+			
+*/
+
+void SPI_TransmitReceiveWord_IT(void *_tx_data, void *_rx_data, uint16_t _size, SPI_WordSizeTypeDef _word_size, SPI_ByteOrderTypeDef _order)
+{
+	
+	uint8_t index = __SPI_WORD_INDEX(0, _word_size, _order);
+	
+	if ((_size > 0) && (SPI_Busy_Claim_IT() != 0))
+	{
+		__SPI_AUTO_POWER_UP
+		
+		SPI_DataControl_IT = SPI_DataControl_IT_Word;
+		
+		/* ------------------------ */
+		g_spi_txdata_it     = (uint8_t *)_tx_data;
+		g_spi_rxdata_it     = (uint8_t *)_rx_data;
+		g_spi_data_size_it  = _size;
+		g_spi_word_size_it  = _word_size;
+		g_spi_word_order_it = _order;
+		g_spi_word_byte_it  = 0;
+		
+		/* Start transmission */
+		SPDR = (_tx_data != 0) ? ((uint8_t *)_tx_data)[index] : _SPI_DUMMY_BYTE;
+		
+		if (SPSR & (1U << WCOL)) /* Transfer in progress, data is not written */
+		{
+			SPI_Transfer_Abort_IT(_SPI_ERROR_WCOL);
+		}
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Transmit and Receive an amount of 16/24/32-bit words in non-blocking
+									mode with Interrupt. The words are split into bytes and assembled in
+									the interrupt.
+			
+			Parameters
+									* _tx_data   : pointer to transmission data buffer (0 = send dummy bytes)
+									* _rx_data   : pointer to reception data buffer (0 = discard received data)
+									* _size      : amount of words to be sent and received
+									* _word_size : _SPI_WORDSIZE_16BIT, _SPI_WORDSIZE_24BIT or _SPI_WORDSIZE_32BIT
+									* _order     : byte order on the bus (_SPI_BYTEORDER_MSB or _SPI_BYTEORDER_LSB)
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint16_t dac_data[32];
+			
+			SPI_TransmitReceiveWord_IT(dac_data, 0, 32, _SPI_WORDSIZE_16BIT, _SPI_BYTEORDER_MSB);
+			
+*/
+
+void SPI_Chain_WriteBit(SPI_ChainTypeDef *_chain, uint16_t _bit, uint8_t _state)
+{
+	
+	uint8_t *pdata = &_chain->Image[_bit >> 3];
+	uint8_t value  = *pdata;
+	
+	if (_state != 0)
+	{
+		value |= (uint8_t)(1U << (_bit & 7U));
+	}
+	else
+	{
+		value &= (uint8_t)~(1U << (_bit & 7U));
+	}
+	
+	if (value != *pdata)
+	{
+		
+		*pdata        = value;
+		_chain->Dirty = 1;
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Change a bit in the shadow image of a shift register chain. The chain
+									is marked dirty only if the bit is changed.
+			
+			Parameters
+									* _chain : pointer to a SPI_ChainTypeDef structure
+									* _bit   : bit number (bit 0 of Image[0] = 0, bit 0 of Image[1] = 8, ...)
+									* _state : 0 = clear, 1 = set
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_Chain_WriteBit(&leds, 37, 1);
+			
+*/
+
+void SPI_Chain_WriteByte(SPI_ChainTypeDef *_chain, uint16_t _index, uint8_t _value)
+{
+	
+	if (_chain->Image[_index] != _value)
+	{
+		
+		_chain->Image[_index] = _value;
+		_chain->Dirty         = 1;
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Change a byte in the shadow image of a shift register chain. The chain
+									is marked dirty only if the byte is changed.
+			
+			Parameters
+									* _chain : pointer to a SPI_ChainTypeDef structure
+									* _index : byte number in the image
+									* _value : new value
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_Chain_WriteByte(&leds, 4, 0xF0);
+			
+*/
+
+uint8_t SPI_Chain_Commit(SPI_ChainTypeDef *_chain, uint32_t _timeout)
+{
+	
+	uint16_t index;
+	uint8_t  ready = 1;
+	
+	if (_chain->Dirty == 0) /* Outputs are up to date */
+	{
+		return 1;
+	}
+	
+	__SPI_AUTO_POWER_UP
+	
+	/* ------------------------ */
+	_chain->Dirty = 0; /* Changes from now are sent by the next commit */
+	
+	for (index = 0; index < _chain->Size; index++) /* Image loop */
+	{
+		/* Start transmission */
+		SPDR = _chain->Image[index];
+		
+		/* Wait for transmission complete */
+		ready = SPI_WaitTransfer(_timeout);
+		
+		if (ready == 0) /* Timeout, the outputs are not latched */
+		{
+			
+			_chain->Dirty = 1;
+			break;
+			
+		}
+		
+	}
+	
+	if (ready != 0) /* Latch the outputs */
+	{
+		
+		*_chain->LatchPort |= (1U << _chain->LatchPin);
+		*_chain->LatchPort &= ~(1U << _chain->LatchPin);
+		
+	}
+	
+	__SPI_AUTO_POWER_DOWN
+	
+	return ready;
+	
+}
+/*
+	Guide   :
+			Function description	Shift the image of a dirty chain out in blocking mode and pulse the
+									latch pin. Nothing is sent if the chain is not changed. On a timeout
+									the latch pin is not pulsed and the chain stays dirty, so the image
+									is sent again by the next commit.
+			
+			Parameters
+									* _chain   : pointer to a SPI_ChainTypeDef structure
+									* _timeout : Timeout duration of each byte (ms)
+									
+			Return Values
+									* 1 : Outputs are latched or the chain is not changed
+									* 0 : Timeout (chain stays dirty)
+			
+	Example :
+			
+			if (SPI_Chain_Commit(&leds, 10) == 0)
+			{
+				// Bus is stalled
+			}
+			
+*/
+uint8_t SPI_Chain_Commit_IT(SPI_ChainTypeDef *_chain)
+{
+	
+	if ((_chain->Dirty == 0) || (_chain->Size == 0) || (SPI_Busy_Claim_IT() == 0))
+	{
+		return 0;
+	}
+	
+	__SPI_AUTO_POWER_UP
+	
+	SPI_DataControl_IT = SPI_DataControl_IT_Chain;
+	
+	/* ------------------------ */
+	_chain->Dirty = 0; /* Changes from now are sent by the next commit */
+	
+	g_spi_chain_it     = _chain;
+	g_spi_txdata_it    = (_chain->Image + 1);
+	g_spi_data_size_it = _chain->Size - 1;
+	
+	/* Start transmission */
+	SPDR = _chain->Image[0];
+	
+	if (SPSR & (1U << WCOL)) /* Transfer in progress, data is not written */
+	{
+		
+		SPI_Transfer_Abort_IT(_SPI_ERROR_WCOL);
+		_chain->Dirty = 1;
+		
+		return 0;
+		
+	}
+	
+	return 1;
+	
+}
+/*
+	Guide   :
+			Function description	Shift the image of a dirty chain out in non-blocking mode with
+									Interrupt, the latch pin is pulsed by the interrupt at the end. Nothing
+									is sent if the chain is not changed. Call it from a timer interrupt to
+									refresh the chain at a fixed rate, the SPI is claimed with interrupts
+									disabled so it does not collide with a transfer started by the main
+									loop (SPI_x_IT, SPI_Schedule_IT).
+			
+			Parameters
+									* _chain : pointer to a SPI_ChainTypeDef structure
+									
+			Return Values
+									* 1 : Transfer is started
+									* 0 : Chain is not changed or SPI is busy (chain stays dirty)
+			
+	Example :
+			
+			uint8_t led_image[12];
+			SPI_ChainTypeDef leds;
+			
+			leds.Image     = led_image;
+			leds.Size      = 12;
+			leds.LatchPort = &PORTB;
+			leds.LatchPin  = 3;
+			leds.Dirty     = 1;
+			
+			// In the timer interrupt
+			SPI_Chain_Commit_IT(&leds);
+			
+*/
+
+SPI_ErrorTypeDef SPI_GetError_IT(void)
+{
+	
+	SPI_ErrorTypeDef error = (SPI_ErrorTypeDef)g_spi_error_it;
+	
+	g_spi_error_it = _SPI_ERROR_NONE;
+	
+	return error;
+	
+}
+/*
+	Guide   :
+			Function description	Get the error of the last interrupt transfer. The error is cleared
+									after reading. An aborted transfer also calls SPI_TxCpltCallback.
+			
+			Parameters
+									-
+									
+			Return Values
+									* _SPI_ERROR_NONE : No error
+									* _SPI_ERROR_MODF : Master mode is lost (SS pin is driven low)
+									* _SPI_ERROR_WCOL : SPI was busy, transfer is not started
+			
+	Example :
+			
+			void SPI_TxCpltCallback(void)
+			{
+				
+				if (SPI_GetError_IT() != _SPI_ERROR_NONE)
+				{
+					// ...
+				}
+				
+			}
+			
+*/
+
+void SPI_PowerDown(void)
+{
+	
+	if (g_spi_power_down == 0)
+	{
+		
+		/* Save the current configuration */
+		g_spi_spcr_run = SPCR & _SPI_SPCR_RUN_BITS;
+		g_spi_spcr_cfg = SPCR & (uint8_t)~_SPI_SPCR_RUN_BITS;
+		g_spi_spsr_cfg = SPSR & (1U << SPI2X);
+		
+		/* Stop the SPI clock */
+		__SPI_CLOCK_OFF
+		
+		g_spi_power_down = 1;
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Stop the SPI clock to save power (PRR or PRR0 clock gating on
+									devices with PRSPI, SPI disable on the others). The SPI configuration
+									is kept and restored by SPI_PowerUp. The initialization functions
+									restart the clock. The enable macros (__SPI_ENABLE_IT, ...) can be
+									used in power down, they are applied by SPI_PowerUp.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_PowerDown();
+			
+*/
+
+void SPI_PowerUp(void)
+{
+	
+	if (g_spi_power_down != 0)
+	{
+		
+		/* Start the SPI clock */
+		__SPI_CLOCK_ON
+		
+		/* Restore the configuration */
+		SPSR = g_spi_spsr_cfg;
+		SPCR = g_spi_spcr_cfg | g_spi_spcr_run;
+		
+		g_spi_power_down = 0;
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Restart the SPI clock and restore the SPI configuration.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_PowerUp();
+			
+*/
+
+void SPI_RunControl(uint8_t _bits, uint8_t _state)
+{
+	
+	uint8_t sreg = SPI_GlobalIT_Lock(); /* The interrupt can power the SPI up or down */
+	
+	if (g_spi_power_down != 0) /* Registers are not written, applied by SPI_PowerUp */
+	{
+		
+		if (_state != 0)
+		{
+			g_spi_spcr_run |= (_bits & _SPI_SPCR_RUN_BITS);
+		}
+		else
+		{
+			g_spi_spcr_run &= (uint8_t)~_bits;
+		}
+		
+	}
+	else
+	{
+		
+		if (_state != 0)
+		{
+			SPCR |= (_bits & _SPI_SPCR_RUN_BITS);
+		}
+		else
+		{
+			SPCR &= (uint8_t)~(_bits & _SPI_SPCR_RUN_BITS);
+		}
+		
+	}
+	
+	SREG = sreg;
+	
+}
+/*
+	Guide   :
+			Function description	Set or clear the SPI enable (SPE) and SPI interrupt enable (SPIE) bits,
+									used by the __SPI_ENABLE, __SPI_DISABLE, __SPI_ENABLE_IT and
+									__SPI_DISABLE_IT macros. In power down, the bits are applied by
+									SPI_PowerUp.
+			
+			Parameters
+									* _bits  : (1U << SPE) and/or (1U << SPIE)
+									* _state : 1 to set, 0 to clear
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_RunControl((1U << SPIE), 1);
+			
+*/
+
+void SPI_WaitForComplete_IT(void)
+{
+	
+	#ifdef __CODEVISIONAVR__
+		
+		sleep_enable();
+		
+		#asm("cli")
+		
+		while (g_spi_busy_it != 0) /* Tested with interrupts disabled, the wake up is not lost */
+		{
+			
+			#asm
+				sei   ; The sleep instruction is executed before a pending interrupt
+				sleep
+				cli
+			#endasm
+			
+		}
+		
+		#asm("sei")
+		
+		sleep_disable();
+		
+	#else
+		
+		_SPI_SLEEP_IDLE_WHILE(g_spi_busy_it != 0);
+		
+	#endif /* __CODEVISIONAVR__ */
+	
+}
+/*
+	Guide   :
+			Function description	Wait for the end of the interrupt transfer in idle sleep mode. The CPU
+									is woken up by the SPI interrupt. The end of the transfer is tested
+									with interrupts disabled, they are enabled just before the sleep
+									instruction. On CodeVisionAVR the sleep mode bits must select idle
+									(reset value).
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_Transmit_IT(data_for_transmit, 50);
+			SPI_WaitForComplete_IT();
+			
+*/
+
+void SPI_Schedule_IT(SPI_TransactionTypeDef *_trans, SPI_LaneTypeDef _lane)
+{
+	
+	uint8_t spie_old;
+	
+	if (_lane >= _SPI_LANE_COUNT) /* Invalid lane */
+	{
+		return;
+	}
+	
+	/* Lock the scheduler */
+	spie_old = SPCR & (1U << SPIE);
+	
+	SPCR &= ~(1U << SPIE);
+	
+	/* Add to the end of the lane */
+	_trans->Next      = 0;
+	_trans->Lane      = _lane;
+	_trans->State     = _SPI_TRANSACTION_QUEUED;
+	_trans->Timestamp = _SPI_SCHED_TIMESTAMP();
+	
+	if (g_spi_sched_tail[_lane] != 0)
+	{
+		g_spi_sched_tail[_lane]->Next = _trans;
+	}
+	else
+	{
+		g_spi_sched_head[_lane] = _trans;
+	}
+	
+	g_spi_sched_tail[_lane] = _trans;
+	
+	/* ------------------------ */
+	if (SPI_Busy_Claim_IT() != 0) /* Bus is idle, else started at the end of the current transfer */
+	{
+		SPI_Schedule_Next();
+	}
+	
+	SPCR |= spie_old;
+	
+}
+/*
+	Guide   :
+			Function description	Queue a transaction in a priority lane. Transactions are started by the
+									SPI interrupt, the highest priority lane first. A higher priority
+									transaction is started at the end of the current transaction. The CS
+									pin of the device stays low and the SPI is not reconfigured between
+									back-to-back transactions of the same device. A transaction queued
+									during another interrupt transfer is started at its end. The SPI
+									interrupt enable bit is not changed.
+			
+			Parameters
+									* _trans : pointer to a SPI_TransactionTypeDef structure (must be kept
+											   while its State is _SPI_TRANSACTION_QUEUED or
+											   _SPI_TRANSACTION_BUSY)
+									* _lane  : priority lane (SPI_LaneTypeDef), the transaction is
+											   not queued if the lane is not valid
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_DeviceTypeDef      imu;
+			SPI_TransactionTypeDef imu_read;
+			
+			imu.Init   = imu_cfg;
+			imu.CSPort = &PORTB;
+			imu.CSPin  = 4;
+			
+			imu_read.Device = &imu;
+			imu_read.TxData = imu_cmd;
+			imu_read.RxData = imu_data;
+			imu_read.Size   = 7;
+			
+			__SPI_ENABLE_IT
+			
+			SPI_Schedule_IT(&imu_read, _SPI_LANE_HIGH);
+			
+			while ((imu_read.State == _SPI_TRANSACTION_QUEUED) || (imu_read.State == _SPI_TRANSACTION_BUSY));
+			
+*/
+
+void SPI_GetLaneStat(SPI_LaneTypeDef _lane, SPI_LaneStatTypeDef *_stat)
+{
+	
+	uint8_t spie_old = SPCR & (1U << SPIE);
+	
+	if (_lane >= _SPI_LANE_COUNT) /* Invalid lane */
+	{
+		return;
+	}
+	
+	SPCR &= ~(1U << SPIE);
+	
+	*_stat = g_spi_sched_stat[_lane];
+	
+	SPCR |= spie_old;
+	
+}
+/*
+	Guide   :
+			Function description	Get the statistics of a scheduler lane. The latency time base is
+									_SPI_SCHED_TIMESTAMP() (spi_unit_conf.h).
+			
+			Parameters
+									* _lane : scheduler lane (SPI_LaneTypeDef)
+									* _stat : pointer to a SPI_LaneStatTypeDef structure
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_LaneStatTypeDef imu_stat;
+			
+			SPI_GetLaneStat(_SPI_LANE_HIGH, &imu_stat);
+			
+*/
+
+void SPI_ResetLaneStat(void)
+{
+	
+	uint8_t spie_old = SPCR & (1U << SPIE);
+	uint8_t lane;
+	
+	SPCR &= ~(1U << SPIE);
+	
+	for (lane = 0; lane < _SPI_LANE_COUNT; lane++)
+	{
+		
+		g_spi_sched_stat[lane].Completed    = 0;
+		g_spi_sched_stat[lane].MaxLatency   = 0;
+		g_spi_sched_stat[lane].TotalLatency = 0;
+		
+	}
+	
+	SPCR |= spie_old;
+	
+}
+/*
+	Guide   :
+			Function description	Reset the statistics of all scheduler lanes.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_ResetLaneStat();
+			
+*/
+
+static void SPI_Schedule_Next(void)
+{
+	
+	SPI_TransactionTypeDef *trans;
+	uint8_t lane;
+	
+	for (;;) /* Skip the empty transactions */
+	{
+		
+		/* Find the highest priority transaction */
+		for (lane = 0; (lane < _SPI_LANE_COUNT) && (g_spi_sched_head[lane] == 0); lane++);
+		
+		if (lane == _SPI_LANE_COUNT) /* All lanes are empty */
+		{
+			
+			if (g_spi_sched_device != 0) /* Release the CS pin */
+			{
+				*g_spi_sched_device->CSPort |= (1U << g_spi_sched_device->CSPin);
+			}
+			
+			SPI_DataControl_IT = SPI_DataControl_IT_Idle;
+			
+			g_spi_sched_device  = 0;
+			g_spi_sched_current = 0;
+			g_spi_busy_it       = 0;
+			
+			__SPI_AUTO_POWER_DOWN
+			
+			return;
+			
+		}
+		
+		/* Remove from the lane */
+		trans = g_spi_sched_head[lane];
+		
+		g_spi_sched_head[lane] = trans->Next;
+		
+		if (g_spi_sched_head[lane] == 0)
+		{
+			g_spi_sched_tail[lane] = 0;
+		}
+		
+		/* Select the device */
+		if (trans->Device != g_spi_sched_device)
+		{
+			
+			if (g_spi_sched_device != 0) /* Release the CS pin */
+			{
+				*g_spi_sched_device->CSPort |= (1U << g_spi_sched_device->CSPin);
+			}
+			
+			__SPI_AUTO_POWER_UP
+			
+			SPI_ReConfig(&trans->Device->Init);
+			
+			*trans->Device->CSPort &= ~(1U << trans->Device->CSPin);
+			g_spi_sched_device = trans->Device;
+			
+		}
+		
+		if (trans->Size != 0)
+		{
+			break;
+		}
+		
+		/* Empty transaction is done */
+		SPI_Schedule_Done(trans);
+		
+	}
+	
+	/* Start the transaction */
+	SPI_DataControl_IT = SPI_DataControl_IT_Schedule;
+	
+	trans->State        = _SPI_TRANSACTION_BUSY;
+	g_spi_sched_current = trans;
+	
+	g_spi_busy_it      = 1;
+	g_spi_txdata_it    = trans->TxData;
+	g_spi_rxdata_it    = trans->RxData;
+	g_spi_data_size_it = trans->Size - 1;
+	
+	if (g_spi_txdata_it != 0)
+	{
+		
+		SPDR = *g_spi_txdata_it;
+		g_spi_txdata_it++;
+		
+	}
+	else
+	{
+		SPDR = _SPI_DUMMY_BYTE;
+	}
+	
+}
+
+static void SPI_Schedule_Done(SPI_TransactionTypeDef *_trans)
+{
+	
+	uint16_t latency = _SPI_SCHED_TIMESTAMP() - _trans->Timestamp;
+	
+	/* Update the lane statistics */
+	g_spi_sched_stat[_trans->Lane].Completed++;
+	g_spi_sched_stat[_trans->Lane].TotalLatency += latency;
+	
+	if (latency > g_spi_sched_stat[_trans->Lane].MaxLatency)
+	{
+		g_spi_sched_stat[_trans->Lane].MaxLatency = latency;
+	}
+	
+	_trans->State = _SPI_TRANSACTION_DONE;
+	
+}
+
+void SPI_SlaveRegMap_IT(uint8_t *_reg_map, uint8_t _size)
+{
+	
+	SPI_DataControl_IT = SPI_DataControl_IT_SlaveRegMap;
+	
+	/* ------------------------ */
+	g_spi_regmap_it      = _reg_map;
+	g_spi_regmap_size_it = _size;
+	
+	SPI_SlaveRegMap_Restart();
+	
+}
+/*
+	Guide   :
+			Function description	Emulate a register map in slave mode with Interrupt. The first byte
+									of each frame is the register address, the bit _SPI_REGMAP_WRITE_BIT
+									of it selects write (1) or read (0). The next bytes are streamed
+									directly from/to the register map with address auto increment. Past
+									the end of the map, _SPI_DUMMY_BYTE (0xFF) is sent and the
+									received data is ignored.
+			
+			Parameters
+									* _reg_map : pointer to register map
+									* _size    : amount of registers in the map
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t registers[16];
+			
+			SPI_DefaultSlaveInit();
+			SPI_SlaveRegMap_IT(registers, 16);
+			
+*/
+
+void SPI_SlaveRegMap_Restart(void)
+{
+	
+	g_spi_regmap_state_it = _SPI_REGMAP_ADDRESS;
+	
+	/* Response of the address byte */
+	SPDR = _SPI_DUMMY_BYTE;
+	
+}
+/*
+	Guide   :
+			Function description	Wait for a new register address (start of a new frame). Call it
+									when the master releases the SS pin.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_SlaveRegMap_Restart();
+			
+*/
+
+void SPI_SlaveFrame_IT(SPI_FrameTypeDef *_frames, uint8_t _count, uint16_t _size)
+{
+	
+	SPI_DataControl_IT = SPI_DataControl_IT_SlaveFrame;
+	
+	/* ------------------------ */
+	g_spi_frame_it       = _frames;
+	g_spi_frame_count_it = _count;
+	g_spi_frame_size_it  = _size;
+	g_spi_frame_write_it = 0;
+	g_spi_frame_read_it  = 0;
+	
+	g_spi_rxdata_it    = _frames[0].Data;
+	g_spi_data_size_it = _size;
+	
+}
+/*
+	Guide   :
+			Function description	Receive SS framed packets of any length in slave mode with Interrupt.
+									The bytes are written directly into a ring of buffers, each packet (SS
+									low to SS high) fills one buffer. Call SPI_SlaveFrame_SSEdge_IT() from
+									the pin change interrupt of the SS pin. A packet is dropped when no
+									buffer is free, data longer than the buffer is ignored.
+			
+			Parameters
+									* _frames : pointer to an array of SPI_FrameTypeDef (Data is set by the user)
+									* _count  : amount of frames in the array (at least 2)
+									* _size   : size of each Data buffer
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t buffer_a[64], buffer_b[64], buffer_c[64];
+			SPI_FrameTypeDef frames[3] = {{buffer_a}, {buffer_b}, {buffer_c}};
+			
+			SPI_DefaultSlaveInit();
+			SPI_SlaveFrame_IT(frames, 3, 64);
+			
+*/
+
+void SPI_SlaveFrame_SSEdge_IT(void)
+{
+	
+	uint8_t  next;
+	uint16_t length;
+	
+	if (SPSR & (1U << SPIF)) /* Last byte of the packet is not read by the SPI interrupt */
+	{
+		SPI_DataControl_IT_SlaveFrame();
+	}
+	
+	if (_PIN_SPI & (1U << _SS_PIN)) /* End of the packet */
+	{
+		
+		length = g_spi_frame_size_it - g_spi_data_size_it;
+		
+		if (length > 0)
+		{
+			
+			next = g_spi_frame_write_it + 1;
+			
+			if (next == g_spi_frame_count_it)
+			{
+				next = 0;
+			}
+			
+			if (next != g_spi_frame_read_it) /* Hand off the buffer */
+			{
+				
+				g_spi_frame_it[g_spi_frame_write_it].Length = length;
+				g_spi_frame_write_it = next;
+				
+			}
+			/* else: no free buffer, the packet is dropped */
+			
+		}
+		
+		/* Receive the next packet into the free buffer */
+		g_spi_rxdata_it    = g_spi_frame_it[g_spi_frame_write_it].Data;
+		g_spi_data_size_it = g_spi_frame_size_it;
+		
+	}
+	/* else: start of the packet, a first byte that is already received is kept */
+	
+}
+/*
+	Guide   :
+			Function description	Mark a packet boundary. Call it from the pin change interrupt of the
+									SS pin (both edges), the SS level is read from _PIN_SPI. The packet
+									is handed off and the next buffer is armed on the rising edge.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			ISR(PCINT0_vect)
+			{
+				SPI_SlaveFrame_SSEdge_IT();
+			}
+			
+*/
+
+SPI_FrameTypeDef *SPI_SlaveFrame_Get(void)
+{
+	
+	if (g_spi_frame_read_it == g_spi_frame_write_it) /* No packet */
+	{
+		return 0;
+	}
+	
+	return &g_spi_frame_it[g_spi_frame_read_it];
+	
+}
+/*
+	Guide   :
+			Function description	Get the oldest received packet. The packet buffer is owned by the
+									application until SPI_SlaveFrame_Release() is called.
+			
+			Parameters
+									-
+									
+			Return Values
+									* pointer to the frame (Data, Length) or 0 if no packet is received
+			
+	Example :
+			
+			SPI_FrameTypeDef *packet = SPI_SlaveFrame_Get();
+			
+			if (packet != 0)
+			{
+				Process(packet->Data, packet->Length);
+				SPI_SlaveFrame_Release();
+			}
+			
+*/
+
+void SPI_SlaveFrame_Release(void)
+{
+	
+	uint8_t next = g_spi_frame_read_it + 1;
+	
+	if (g_spi_frame_read_it != g_spi_frame_write_it)
+	{
+		
+		if (next == g_spi_frame_count_it)
+		{
+			next = 0;
+		}
+		
+		g_spi_frame_read_it = next;
+		
+	}
+	
+}
+/*
+	Guide   :
+			Function description	Give the buffer of the packet from SPI_SlaveFrame_Get() back to the
+									receiver.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_SlaveFrame_Release();
+			
+*/
+
+static uint8_t SPI_WaitTransfer(uint32_t _timeout)
+{
+	
+	uint16_t poll;
+	
+	/* Busy poll, no delay at the normal SPI clocks */
+	for (poll = _SPI_WAIT_POLLS; poll > 0; poll--)
+	{
+		
+		if (SPSR & (1U << SPIF))
+		{
+			return 1;
+		}
+		
+	}
+	
+	/* Slow or stalled bus, _timeout is the limit of this byte */
+	for (; _timeout > 0; _timeout--)
+	{
+		
+		_DELAY_MS(1);
+		
+		if (SPSR & (1U << SPIF))
+		{
+			return 1;
+		}
+		
+	}
+	
+	return 0;
+	
+}
+
+static uint8_t SPI_Busy_Claim_IT(void)
+{
+	
+	uint8_t sreg    = SPI_GlobalIT_Lock(); /* A start function can be called from another interrupt */
+	uint8_t claimed = 0;
+	
+	if (g_spi_busy_it == 0) /* Test and set */
+	{
+		
+		g_spi_busy_it = 1;
+		claimed       = 1;
+		
+	}
+	
+	SREG = sreg;
+	
+	return claimed;
+	
+}
+
+static uint8_t SPI_GlobalIT_Lock(void)
+{
+	
+	uint8_t sreg = SREG;
+	
+	#ifdef __CODEVISIONAVR__
+		
+		#asm("cli")
+		
+	#else
+		
+		cli();
+		
+	#endif /* __CODEVISIONAVR__ */
+	
+	return sreg; /* Restored by SREG = sreg */
+	
+}
+
+/* ............... IT Data Controls ............... */
+
+static void SPI_Transfer_Done_IT(void)
+{
+	
+	/* Start a transaction scheduled during the transfer (idle if there is none) */
+	SPI_Schedule_Next();
+	
+	SPI_TxCpltCallback();
+	
+}
+
+static void SPI_Transfer_Abort_IT(SPI_ErrorTypeDef _error)
+{
+	
+	SPI_DataControl_IT = SPI_DataControl_IT_Idle;
+	
+	g_spi_error_it = _error;
+	g_spi_busy_it  = 0;
+	
+	if (_error == _SPI_ERROR_MODF) /* MSTR is cleared by the hardware, SPI_ReConfig must rewrite SPCR */
+	{
+		g_spi_spcr_cfg = _SPI_CFG_INVALID;
+	}
+	
+	if (g_spi_sched_current != 0) /* Abort the scheduled transaction */
+	{
+		
+		g_spi_sched_current->State = _SPI_TRANSACTION_ABORTED;
+		
+		*g_spi_sched_device->CSPort |= (1U << g_spi_sched_device->CSPin);
+		
+		g_spi_sched_device  = 0;
+		g_spi_sched_current = 0;
+		
+	}
+	
+	/* Start the next transaction (idle if there is none) */
+	SPI_Schedule_Next();
+	
+	SPI_TxCpltCallback(); /* The error is read by SPI_GetError_IT */
+	
+}
+
+void SPI_DataControl_IT_Idle(void)
+{
+	/* No transfer */
+}
+
+void SPI_DataControl_IT_Transmit(void)
+{
+	
+	if (g_spi_data_size_it > 0)
+	{
+		
+		SPDR = *g_spi_txdata_it;
+		g_spi_txdata_it++;
+		
+		g_spi_data_size_it--;
+		
+	}
+	else /* Last byte is sent */
+	{
+		SPI_Transfer_Done_IT();
+	}
+	
+}
+
+void SPI_DataControl_IT_Receive(void)
+{
+	
+	if (g_spi_data_size_it > 0)
+	{
+		
+		*g_spi_rxdata_it = SPDR;
+		g_spi_rxdata_it++;
+		
+		g_spi_data_size_it--;
+		
+		if (g_spi_data_size_it == 0) /* Last byte is received */
+		{
+			SPI_Transfer_Done_IT();
+		}
+		
+	}
+	
+}
+
+void SPI_DataControl_IT_TransmitReceive(void)
+{
+	
+	/* Read the received byte before the next transmission */
+	*g_spi_rxdata_it = SPDR;
+	g_spi_rxdata_it++;
+	
+	if (g_spi_data_size_it > 0)
+	{
+		
+		SPDR = *g_spi_txdata_it;
+		
+		g_spi_txdata_it++;
+		g_spi_data_size_it--;
+		
+	}
+	else /* Last byte is received */
+	{
+		SPI_Transfer_Done_IT();
+	}
+	
+}
+
+void SPI_DataControl_IT_SlaveRegMap(void)
+{
+	
+	uint8_t data = SPDR;
+	
+	if (g_spi_regmap_state_it == _SPI_REGMAP_ADDRESS) /* Address byte */
+	{
+		
+		g_spi_regmap_index_it = data & (uint8_t)~(1U << _SPI_REGMAP_WRITE_BIT);
+		g_spi_regmap_state_it = (data & (1U << _SPI_REGMAP_WRITE_BIT)) ? _SPI_REGMAP_WRITE : _SPI_REGMAP_READ;
+		
+	}
+	else if (g_spi_regmap_state_it == _SPI_REGMAP_WRITE) /* Write opcode */
+	{
+		
+		if (g_spi_regmap_index_it < g_spi_regmap_size_it) /* The index stops at the end of the map */
+		{
+			
+			g_spi_regmap_it[g_spi_regmap_index_it] = data;
+			g_spi_regmap_index_it++;
+			
+		}
+		
+	}
+	
+	if (g_spi_regmap_state_it == _SPI_REGMAP_READ) /* Load the next response */
+	{
+		
+		if (g_spi_regmap_index_it < g_spi_regmap_size_it)
+		{
+			
+			SPDR = g_spi_regmap_it[g_spi_regmap_index_it];
+			g_spi_regmap_index_it++;
+			
+		}
+		else
+		{
+			SPDR = _SPI_DUMMY_BYTE;
+		}
+		
+	}
+	
+}
+
+void SPI_DataControl_IT_Schedule(void)
+{
+	
+	if (g_spi_rxdata_it != 0)
+	{
+		
+		*g_spi_rxdata_it = SPDR;
+		g_spi_rxdata_it++;
+		
+	}
+	
+	if (g_spi_data_size_it > 0)
+	{
+		
+		if (g_spi_txdata_it != 0)
+		{
+			
+			SPDR = *g_spi_txdata_it;
+			g_spi_txdata_it++;
+			
+		}
+		else
+		{
+			SPDR = _SPI_DUMMY_BYTE;
+		}
+		
+		g_spi_data_size_it--;
+		
+	}
+	else /* Transaction is done */
+	{
+		
+		SPI_Schedule_Done(g_spi_sched_current);
+		
+		/* Start the next transaction */
+		SPI_Schedule_Next();
+		
+		SPI_TxCpltCallback();
+		
+	}
+	
+}
+
+static uint8_t SPI_Pixel_Load_IT(void)
+{
+	
+	if (g_spi_pixel_rows_it == 0) /* No pixel */
+	{
+		return 0;
+	}
+	
+	/* Convert the pixel */
+	g_spi_pixel_color_it = __SPI_RGB565(g_spi_txdata_it[0], g_spi_txdata_it[1], g_spi_txdata_it[2]);
+	
+	/* Find the next pixel */
+	g_spi_txdata_it += _SPI_PIXEL_SIZE;
+	g_spi_pixel_col_it--;
+	
+	if (g_spi_pixel_col_it == 0) /* End of the line */
+	{
+		
+		g_spi_pixel_col_it   = g_spi_pixel_width_it;
+		g_spi_pixel_line_it += g_spi_pixel_stride_it;
+		g_spi_txdata_it      = g_spi_pixel_line_it;
+		
+		g_spi_pixel_rows_it--;
+		
+	}
+	
+	return 1;
+	
+}
+
+void SPI_DataControl_IT_Pixels(void)
+{
+	
+	if (g_spi_pixel_phase_it == _SPI_PIXEL_LOW)
+	{
+		
+		SPDR = (uint8_t)g_spi_pixel_color_it;
+		
+		/* Convert the next pixel while the low byte is sent */
+		g_spi_pixel_phase_it = SPI_Pixel_Load_IT() ? _SPI_PIXEL_HIGH : _SPI_PIXEL_END;
+		
+	}
+	else if (g_spi_pixel_phase_it == _SPI_PIXEL_HIGH)
+	{
+		
+		SPDR = (uint8_t)(g_spi_pixel_color_it >> 8);
+		g_spi_pixel_phase_it = _SPI_PIXEL_LOW;
+		
+	}
+	else /* Last pixel is sent */
+	{
+		SPI_Transfer_Done_IT();
+	}
+	
+}
+
+void SPI_DataControl_IT_FillColor(void)
+{
+	
+	if (g_spi_pixel_phase_it == _SPI_PIXEL_LOW)
+	{
+		
+		SPDR = (uint8_t)g_spi_pixel_color_it;
+		g_spi_pixel_phase_it = _SPI_PIXEL_HIGH;
+		
+	}
+	else if (g_spi_pixel_count_it > 0)
+	{
+		
+		SPDR = (uint8_t)(g_spi_pixel_color_it >> 8);
+		g_spi_pixel_phase_it = _SPI_PIXEL_LOW;
+		
+		g_spi_pixel_count_it--;
+		
+	}
+	else /* Last pixel is sent */
+	{
+		SPI_Transfer_Done_IT();
+	}
+	
+}
+
+void SPI_DataControl_IT_Word(void)
+{
+	
+	uint8_t memory;
+	uint8_t index = __SPI_WORD_INDEX(g_spi_word_byte_it, g_spi_word_size_it, g_spi_word_order_it);
+	
+	if (g_spi_rxdata_it != 0)
+	{
+		g_spi_rxdata_it[index] = SPDR;
+	}
+	
+	g_spi_word_byte_it++;
+	
+	if (g_spi_word_byte_it == g_spi_word_size_it) /* End of the word */
+	{
+		
+		memory = (g_spi_word_size_it == _SPI_WORDSIZE_16BIT) ? _SPI_WORD_16BIT_MEMORY : _SPI_WORD_32BIT_MEMORY;
+		
+		if (g_spi_rxdata_it != 0)
+		{
+			
+			if (g_spi_word_size_it == _SPI_WORDSIZE_24BIT)
+			{
+				g_spi_rxdata_it[_SPI_WORDSIZE_24BIT] = 0;
+			}
+			
+			g_spi_rxdata_it += memory;
+			
+		}
+		
+		if (g_spi_txdata_it != 0)
+		{
+			g_spi_txdata_it += memory;
+		}
+		
+		g_spi_word_byte_it = 0;
+		g_spi_data_size_it--;
+		
+		if (g_spi_data_size_it == 0) /* Last word is sent */
+		{
+			
+			SPI_Transfer_Done_IT();
+			return;
+			
+		}
+		
+	}
+	
+	/* Start transmission of the next byte */
+	index = __SPI_WORD_INDEX(g_spi_word_byte_it, g_spi_word_size_it, g_spi_word_order_it);
+	
+	SPDR = (g_spi_txdata_it != 0) ? g_spi_txdata_it[index] : _SPI_DUMMY_BYTE;
+	
+}
+
+void SPI_DataControl_IT_Chain(void)
+{
+	
+	if (g_spi_data_size_it > 0)
+	{
+		
+		SPDR = *g_spi_txdata_it;
+		g_spi_txdata_it++;
+		
+		g_spi_data_size_it--;
+		
+	}
+	else /* Last byte is sent, latch the outputs */
+	{
+		
+		*g_spi_chain_it->LatchPort |= (1U << g_spi_chain_it->LatchPin);
+		*g_spi_chain_it->LatchPort &= ~(1U << g_spi_chain_it->LatchPin);
+		
+		SPI_Transfer_Done_IT();
+		
+	}
+	
+}
+
+void SPI_DataControl_IT_SlaveFrame(void)
+{
+	
+	uint8_t data = SPDR;
+	
+	if (g_spi_data_size_it > 0) /* Data longer than the buffer is ignored */
+	{
+		
+		*g_spi_rxdata_it = data;
+		g_spi_rxdata_it++;
+		
+		g_spi_data_size_it--;
+		
 	}
 	
 }
@@ -44,6 +44,7 @@ extern "C"
 
 #include <io.h>            /* Import AVR IO library */
 #include <delay.h>         /* Import delay library */
+#include <sleep.h>         /* Import sleep library */
 
 /*----------------------------------------------------------*/
 
@@ -52,7 +53,9 @@ extern "C"
 #pragma GCC diagnostic ignored "-Wunused-function" /* Disable 'unused function' warning */
 
 #include <avr/io.h>        /* Import AVR IO library */
+#include <avr/interrupt.h> /* Import AVR interrupt library */
 #include <util/delay.h>    /* Import delay library */
+#include <avr/sleep.h>     /* Import sleep library */
 
 /*----------------------------------------------------------*/
 
@@ -64,11 +67,70 @@ extern "C"
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
+/* ------ Configuration defaults (missing in older spi_unit_conf.h files) ------ */
+#ifndef _PIN_SPI
+	#define _PIN_SPI               PINB
+#endif /* _PIN_SPI */
+
+#ifndef _SS_PIN
+	#define _SS_PIN                4
+#endif /* _SS_PIN */
+
+#ifndef _SPI_POWER_SAVE
+	#define _SPI_POWER_SAVE        0
+#endif /* _SPI_POWER_SAVE */
+
+#ifndef _SPI_SCHED_TIMESTAMP
+	#define _SPI_SCHED_TIMESTAMP() 0
+#endif /* _SPI_SCHED_TIMESTAMP */
+
+#ifndef _SPI_REGMAP_WRITE_BIT
+	#define _SPI_REGMAP_WRITE_BIT  7
+#endif /* _SPI_REGMAP_WRITE_BIT */
+
 /* ------ SPI Exported Macros ------ */
-#define __SPI_ENABLE     {SPCR |= (1U << SPE);}
-#define __SPI_DISABLE    {SPCR &= ~(1U << SPE);}
-#define __SPI_ENABLE_IT  {SPCR |= (1U << SPIE);}
-#define __SPI_DISABLE_IT {SPCR &= ~(1U << SPIE);}
+#define __SPI_ENABLE     {SPI_RunControl((1U << SPE), 1);}  /* Applied by SPI_PowerUp in power down */
+#define __SPI_DISABLE    {SPI_RunControl((1U << SPE), 0);}
+#define __SPI_ENABLE_IT  {SPI_RunControl((1U << SPIE), 1);}
+#define __SPI_DISABLE_IT {SPI_RunControl((1U << SPIE), 0);}
+
+/* ------ SPI Pixel Color ------ */
+#define __SPI_RGB565(_r, _g, _b) ((uint16_t)((((uint16_t)(_r) & 0xF8U) << 8) | (((uint16_t)(_g) & 0xFCU) << 3) | ((uint8_t)(_b) >> 3)))
+
+/*
+	Guide  :
+			__SPI_RGB565 : Convert a RGB888 color (8-bit red, green and blue) to RGB565.
+			
+	Example:
+			SPI_FillColor(__SPI_RGB565(255, 128, 0), 100, 10);
+*/
+
+/* ------ SPI Clock Rate Selection ------ */
+#define __SPI_CLOCKRATE_SELECT(_max_freq) ( ((F_CPU / 2UL)  <= (_max_freq)) ? _SPI_CLOCKRATE_FCPU_2  : \
+                                            ((F_CPU / 4UL)  <= (_max_freq)) ? _SPI_CLOCKRATE_FCPU_4  : \
+                                            ((F_CPU / 8UL)  <= (_max_freq)) ? _SPI_CLOCKRATE_FCPU_8  : \
+                                            ((F_CPU / 16UL) <= (_max_freq)) ? _SPI_CLOCKRATE_FCPU_16 : \
+                                            ((F_CPU / 32UL) <= (_max_freq)) ? _SPI_CLOCKRATE_FCPU_32 : \
+                                            ((F_CPU / 64UL) <= (_max_freq)) ? _SPI_CLOCKRATE_FCPU_64 : _SPI_CLOCKRATE_FCPU_128 )
+
+#define __SPI_CLOCKRATE_FREQ(_rate) ( ((_rate) == _SPI_CLOCKRATE_FCPU_2)  ? (F_CPU / 2UL)  : \
+                                      ((_rate) == _SPI_CLOCKRATE_FCPU_4)  ? (F_CPU / 4UL)  : \
+                                      ((_rate) == _SPI_CLOCKRATE_FCPU_8)  ? (F_CPU / 8UL)  : \
+                                      ((_rate) == _SPI_CLOCKRATE_FCPU_16) ? (F_CPU / 16UL) : \
+                                      ((_rate) == _SPI_CLOCKRATE_FCPU_32) ? (F_CPU / 32UL) : \
+                                      ((_rate) == _SPI_CLOCKRATE_FCPU_64) ? (F_CPU / 64UL) : (F_CPU / 128UL) )
+
+/*
+	Guide  :
+			__SPI_CLOCKRATE_SELECT : Fastest SPI_CLKRateTypeDef that does not exceed _max_freq (Hz).
+			                         If _max_freq is lower than F_CPU/128, _SPI_CLOCKRATE_FCPU_128 is selected.
+			__SPI_CLOCKRATE_FREQ   : SPI clock frequency (Hz) of a SPI_CLKRateTypeDef.
+			
+			Both are evaluated at compile time when the parameter is a constant.
+			
+	Example:
+			spi_cfg.ClockFrequency = __SPI_CLOCKRATE_SELECT(2000000UL);
+*/
 
 /* ---------------------------- Public ---------------------------- */
 /* ---------------------- Define by compiler ---------------------- */
@@ -77,6 +139,10 @@ extern "C"
 	
 	#define _SPI_IT_VECT SPI_STC
 	
+	#ifndef F_CPU
+		#define F_CPU _MCU_CLOCK_FREQUENCY_
+	#endif /* F_CPU */
+	
 	#ifndef _INTERRUPT
 		#define _INTERRUPT(vect)  interrupt [vect] void spi_isr(void)
 	#endif
@@ -97,6 +163,10 @@ extern "C"
 		#define _DELAY_MS(x)    _delay_ms(x)
 	#endif /* _DELAY_MS */
 	
+	#ifndef _SPI_SLEEP_IDLE_WHILE
+		#define _SPI_SLEEP_IDLE_WHILE(cond)  {set_sleep_mode(SLEEP_MODE_IDLE); cli(); while (cond) {sleep_enable(); sei(); sleep_cpu(); sleep_disable(); cli();} sei();}
+	#endif /* _SPI_SLEEP_IDLE_WHILE */
+	
 #endif /* __CODEVISIONAVR__ */
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Variables ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -147,6 +217,53 @@ typedef enum /* SPI Clock Rates */
 	
 }SPI_CLKRateTypeDef;
 
+typedef enum /* SPI Word Sizes */
+{
+	
+	_SPI_WORDSIZE_16BIT = 2U,
+	_SPI_WORDSIZE_24BIT = 3U,
+	_SPI_WORDSIZE_32BIT = 4U
+	
+}SPI_WordSizeTypeDef;
+
+typedef enum /* SPI Word Byte Orders */
+{
+	
+	_SPI_BYTEORDER_MSB = 0,
+	_SPI_BYTEORDER_LSB = 1U
+	
+}SPI_ByteOrderTypeDef;
+
+typedef enum /* SPI Scheduler Lanes (priority order) */
+{
+	
+	_SPI_LANE_HIGH   = 0,
+	_SPI_LANE_NORMAL = 1U,
+	_SPI_LANE_LOW    = 2U,
+	
+	_SPI_LANE_COUNT  = 3U
+	
+}SPI_LaneTypeDef;
+
+typedef enum /* SPI Transaction States */
+{
+	
+	_SPI_TRANSACTION_DONE    = 0,
+	_SPI_TRANSACTION_QUEUED  = 1U,
+	_SPI_TRANSACTION_BUSY    = 2U,
+	_SPI_TRANSACTION_ABORTED = 3U
+	
+}SPI_TransactionStateTypeDef;
+
+typedef enum /* SPI Interrupt Transfer Errors */
+{
+	
+	_SPI_ERROR_NONE = 0,
+	_SPI_ERROR_MODF = 1U,
+	_SPI_ERROR_WCOL = 2U
+	
+}SPI_ErrorTypeDef;
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Struct ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 typedef struct /* structure that contains the configuration information for the specified SPI properties */
@@ -160,6 +277,61 @@ typedef struct /* structure that contains the configuration information for the
 	
 }SPI_InitTypeDef;
 
+typedef struct /* structure that contains the information of a device on the SPI bus */
+{
+	
+	SPI_InitTypeDef  Init;   /* Configuration of the device */
+	volatile uint8_t *CSPort; /* PORTx register of the CS pin */
+	uint8_t          CSPin;  /* CS pin number (active low) */
+	
+}SPI_DeviceTypeDef;
+
+typedef struct SPI_Transaction /* structure that contains the information of a scheduled transfer */
+{
+	
+	SPI_DeviceTypeDef      *Device; /* Target device */
+	uint8_t                *TxData; /* Transmission data buffer (0 = send dummy bytes) */
+	uint8_t                *RxData; /* Reception data buffer (0 = discard received data) */
+	uint16_t               Size;    /* Amount of data to be sent and received */
+	
+	volatile SPI_TransactionStateTypeDef State; /* Set by the scheduler */
+	
+	/* Used by the scheduler */
+	struct SPI_Transaction *Next;
+	uint16_t               Timestamp;
+	uint8_t                Lane;
+	
+}SPI_TransactionTypeDef;
+
+typedef struct /* structure that contains the information of a shift register chain (74HC595, ...) */
+{
+	
+	uint8_t          *Image;     /* Shadow image of the chain (Image[0] is shifted first) */
+	uint16_t         Size;       /* Amount of bytes in the chain */
+	volatile uint8_t *LatchPort; /* PORTx register of the latch pin */
+	uint8_t          LatchPin;   /* Latch pin number (latched on rising edge) */
+	
+	volatile uint8_t Dirty;      /* Image is changed and not sent */
+	
+}SPI_ChainTypeDef;
+
+typedef struct /* structure that contains the information of a SS framed packet buffer */
+{
+	
+	uint8_t           *Data;  /* Packet buffer */
+	volatile uint16_t Length; /* Amount of received data (set by the receiver) */
+	
+}SPI_FrameTypeDef;
+
+typedef struct /* structure that contains the statistics of a scheduler lane */
+{
+	
+	uint16_t Completed;    /* Amount of completed transactions */
+	uint16_t MaxLatency;   /* Maximum time from scheduling to completion */
+	uint32_t TotalLatency; /* Sum of the latencies (average = TotalLatency / Completed) */
+	
+}SPI_LaneStatTypeDef;
+
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Prototype ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
 
 void SPI_Init(SPI_InitTypeDef *_spi_cfg);
@@ -188,6 +360,74 @@ void SPI_Init(SPI_InitTypeDef *_spi_cfg);
 			
 */
 
+void SPI_ReConfig(SPI_InitTypeDef *_spi_cfg);
+/*
+	Guide   :
+			Function description	Change the SPI configuration without disabling it. The last applied
+									configuration is cached and only the changed registers are written.
+									The SPI pins direction is not changed (set it by SPI_Init).
+									In power down, the configuration is applied by SPI_PowerUp.
+									Do not call it while scheduled transactions (SPI_Schedule_IT) are
+									queued or running, the scheduler applies the device configuration.
+			
+			Parameters
+									* _spi_cfg : pointer to a SPI_InitTypeDef structure that contains
+												 the configuration information for SPI module.
+									
+			Return Values
+									-
+			
+	Example :
+			SPI_InitTypeDef flash_cfg;
+			SPI_InitTypeDef adc_cfg;
+			
+			SPI_Init(&flash_cfg);
+			__SPI_ENABLE
+			
+			SPI_ReConfig(&adc_cfg);
+			SPI_TransmitReceive(adc_cmd, adc_data, 3, 100);
+			
+			SPI_ReConfig(&flash_cfg);
+			SPI_Transmit(flash_cmd, 4, 100);
+			
+*/
+
+SPI_CLKRateTypeDef SPI_GetClockRate(uint32_t _max_freq);
+/*
+	Guide   :
+			Function description	Find the fastest SPI clock rate that does not exceed the maximum
+									frequency of the device (without division).
+			
+			Parameters
+									* _max_freq : maximum SPI clock frequency of the device in Hz
+									
+			Return Values
+									* SPI_CLKRateTypeDef value (_SPI_CLOCKRATE_FCPU_128 if _max_freq
+									  is lower than F_CPU/128)
+			
+	Example :
+			
+			spi_cfg.ClockFrequency = SPI_GetClockRate(device_max_freq);
+			
+*/
+
+uint32_t SPI_GetClockFrequency(SPI_CLKRateTypeDef _rate);
+/*
+	Guide   :
+			Function description	Get the SPI clock frequency of a clock rate.
+			
+			Parameters
+									* _rate : SPI_CLKRateTypeDef value
+									
+			Return Values
+									* SPI clock frequency in Hz
+			
+	Example :
+			
+			uint32_t achieved_freq = SPI_GetClockFrequency(spi_cfg.ClockFrequency);
+			
+*/
+
 void SPI_DeInit(void);
 /*
 	Guide   :
@@ -366,6 +606,598 @@ void SPI_TransmitReceive_IT(uint8_t *_tx_data, uint8_t *_rx_data, uint16_t _size
 			
 */
 
+void SPI_TransmitWord(void *_pdata, uint16_t _size, SPI_WordSizeTypeDef _word_size, SPI_ByteOrderTypeDef _order, uint32_t _timeout);
+/*
+	Guide   :
+			Function description	Transmit an amount of 16/24/32-bit words in blocking mode. The words
+									are split into bytes in the transfer loop (no byte buffer is needed).
+			
+			Parameters
+									* _pdata     : pointer to data buffer (uint16_t for 16-bit words,
+												   uint32_t for 24/32-bit words)
+									* _size      : amount of words to be sent
+									* _word_size : _SPI_WORDSIZE_16BIT, _SPI_WORDSIZE_24BIT or _SPI_WORDSIZE_32BIT
+									* _order     : byte order on the bus (_SPI_BYTEORDER_MSB = most significant
+												   byte first, _SPI_BYTEORDER_LSB = least significant byte first)
+									* _timeout   : Timeout duration of each byte (ms), the transfer is
+												   stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint16_t dac_data[32];
+			
+			SPI_TransmitWord(dac_data, 32, _SPI_WORDSIZE_16BIT, _SPI_BYTEORDER_MSB, 10);
+			
+*/
+
+void SPI_TransmitReceiveWord(void *_tx_data, void *_rx_data, uint16_t _size, SPI_WordSizeTypeDef _word_size, SPI_ByteOrderTypeDef _order, uint32_t _timeout);
+/*
+	Guide   :
+			Function description	Transmit and Receive an amount of 16/24/32-bit words in blocking mode.
+									The words are split into bytes and assembled in the transfer loop.
+			
+			Parameters
+									* _tx_data   : pointer to transmission data buffer (0 = send dummy bytes)
+									* _rx_data   : pointer to reception data buffer (0 = discard received data)
+									* _size      : amount of words to be sent and received
+									* _word_size : _SPI_WORDSIZE_16BIT, _SPI_WORDSIZE_24BIT or _SPI_WORDSIZE_32BIT
+									* _order     : byte order on the bus (_SPI_BYTEORDER_MSB or _SPI_BYTEORDER_LSB)
+									* _timeout   : Timeout duration of each byte (ms), the transfer is
+												   stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint32_t adc_data[8]; // 24-bit samples
+			
+			SPI_TransmitReceiveWord(0, adc_data, 8, _SPI_WORDSIZE_24BIT, _SPI_BYTEORDER_MSB, 10);
+			
+*/
+
+void SPI_TransmitReceiveWord_IT(void *_tx_data, void *_rx_data, uint16_t _size, SPI_WordSizeTypeDef _word_size, SPI_ByteOrderTypeDef _order);
+/*
+	Guide   :
+			Function description	Transmit and Receive an amount of 16/24/32-bit words in non-blocking
+									mode with Interrupt. The words are split into bytes and assembled in
+									the interrupt.
+			
+			Parameters
+									* _tx_data   : pointer to transmission data buffer (0 = send dummy bytes)
+									* _rx_data   : pointer to reception data buffer (0 = discard received data)
+									* _size      : amount of words to be sent and received
+									* _word_size : _SPI_WORDSIZE_16BIT, _SPI_WORDSIZE_24BIT or _SPI_WORDSIZE_32BIT
+									* _order     : byte order on the bus (_SPI_BYTEORDER_MSB or _SPI_BYTEORDER_LSB)
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint16_t dac_data[32];
+			
+			SPI_TransmitReceiveWord_IT(dac_data, 0, 32, _SPI_WORDSIZE_16BIT, _SPI_BYTEORDER_MSB);
+			
+*/
+
+void SPI_TransmitPixels(uint8_t *_pdata, uint16_t _width, uint16_t _height, uint16_t _stride, uint32_t _timeout);
+/*
+	Guide   :
+			Function description	Transmit a window of RGB888 pixels as RGB565 (high byte first) in
+									blocking mode. The next pixel is converted while the current byte
+									is sent, no RGB565 buffer is needed.
+			
+			Parameters
+									* _pdata   : pointer to the first pixel of the window (3 bytes: R, G, B)
+									* _width   : window width in pixels
+									* _height  : window height in pixels
+									* _stride  : source line length in pixels (_width for a line buffer)
+									* _timeout : Timeout duration of each byte (ms), the transfer is
+												 stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t frame[240][320][3];
+			
+			// Dirty rectangle x = 10, y = 20, 50 x 30 pixels (set the display window first)
+			SPI_TransmitPixels(&frame[20][10][0], 50, 30, 320, 10);
+			
+*/
+
+void SPI_TransmitPixels_IT(uint8_t *_pdata, uint16_t _width, uint16_t _height, uint16_t _stride);
+/*
+	Guide   :
+			Function description	Transmit a window of RGB888 pixels as RGB565 (high byte first) in
+									non-blocking mode with Interrupt. The next pixel is converted in the
+									interrupt while the current byte is sent.
+			
+			Parameters
+									* _pdata   : pointer to the first pixel of the window (3 bytes: R, G, B)
+									* _width   : window width in pixels
+									* _height  : window height in pixels
+									* _stride  : source line length in pixels (_width for a line buffer)
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t line[320][3];
+			
+			SPI_TransmitPixels_IT(&line[0][0], 320, 1, 320);
+			
+*/
+
+void SPI_FillColor(uint16_t _color, uint32_t _count, uint32_t _timeout);
+/*
+	Guide   :
+			Function description	Transmit a RGB565 color (high byte first) repeatedly in blocking mode,
+									for example to fill a rectangle. No source buffer is needed.
+			
+			Parameters
+									* _color   : RGB565 color
+									* _count   : amount of pixels
+									* _timeout : Timeout duration of each byte (ms), the transfer is
+												 stopped at a timeout
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_FillColor(__SPI_RGB565(255, 0, 0), 320UL * 240UL, 10);
+			
+*/
+
+void SPI_FillColor_IT(uint16_t _color, uint32_t _count);
+/*
+	Guide   :
+			Function description	Transmit a RGB565 color (high byte first) repeatedly in non-blocking
+									mode with Interrupt. No source buffer is needed.
+			
+			Parameters
+									* _color   : RGB565 color
+									* _count   : amount of pixels
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_FillColor_IT(__SPI_RGB565(0, 0, 255), 50UL * 30UL);
+			
+*/
+
+void SPI_Chain_WriteBit(SPI_ChainTypeDef *_chain, uint16_t _bit, uint8_t _state);
+/*
+	Guide   :
+			Function description	Change a bit in the shadow image of a shift register chain. The chain
+									is marked dirty only if the bit is changed.
+			
+			Parameters
+									* _chain : pointer to a SPI_ChainTypeDef structure
+									* _bit   : bit number (bit 0 of Image[0] = 0, bit 0 of Image[1] = 8, ...)
+									* _state : 0 = clear, 1 = set
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_Chain_WriteBit(&leds, 37, 1);
+			
+*/
+
+void SPI_Chain_WriteByte(SPI_ChainTypeDef *_chain, uint16_t _index, uint8_t _value);
+/*
+	Guide   :
+			Function description	Change a byte in the shadow image of a shift register chain. The chain
+									is marked dirty only if the byte is changed.
+			
+			Parameters
+									* _chain : pointer to a SPI_ChainTypeDef structure
+									* _index : byte number in the image
+									* _value : new value
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_Chain_WriteByte(&leds, 4, 0xF0);
+			
+*/
+
+uint8_t SPI_Chain_Commit(SPI_ChainTypeDef *_chain, uint32_t _timeout);
+/*
+	Guide   :
+			Function description	Shift the image of a dirty chain out in blocking mode and pulse the
+									latch pin. Nothing is sent if the chain is not changed. On a timeout
+									the latch pin is not pulsed and the chain stays dirty, so the image
+									is sent again by the next commit.
+			
+			Parameters
+									* _chain   : pointer to a SPI_ChainTypeDef structure
+									* _timeout : Timeout duration of each byte (ms)
+									
+			Return Values
+									* 1 : Outputs are latched or the chain is not changed
+									* 0 : Timeout (chain stays dirty)
+			
+	Example :
+			
+			if (SPI_Chain_Commit(&leds, 10) == 0)
+			{
+				// Bus is stalled
+			}
+			
+*/
+
+uint8_t SPI_Chain_Commit_IT(SPI_ChainTypeDef *_chain);
+/*
+	Guide   :
+			Function description	Shift the image of a dirty chain out in non-blocking mode with
+									Interrupt, the latch pin is pulsed by the interrupt at the end. Nothing
+									is sent if the chain is not changed. Call it from a timer interrupt to
+									refresh the chain at a fixed rate, the SPI is claimed with interrupts
+									disabled so it does not collide with a transfer started by the main
+									loop (SPI_x_IT, SPI_Schedule_IT).
+			
+			Parameters
+									* _chain : pointer to a SPI_ChainTypeDef structure
+									
+			Return Values
+									* 1 : Transfer is started
+									* 0 : Chain is not changed or SPI is busy (chain stays dirty)
+			
+	Example :
+			
+			uint8_t led_image[12];
+			SPI_ChainTypeDef leds;
+			
+			leds.Image     = led_image;
+			leds.Size      = 12;
+			leds.LatchPort = &PORTB;
+			leds.LatchPin  = 3;
+			leds.Dirty     = 1;
+			
+			// In the timer interrupt
+			SPI_Chain_Commit_IT(&leds);
+			
+*/
+
+SPI_ErrorTypeDef SPI_GetError_IT(void);
+/*
+	Guide   :
+			Function description	Get the error of the last interrupt transfer. The error is cleared
+									after reading. An aborted transfer also calls SPI_TxCpltCallback.
+			
+			Parameters
+									-
+									
+			Return Values
+									* _SPI_ERROR_NONE : No error
+									* _SPI_ERROR_MODF : Master mode is lost (SS pin is driven low)
+									* _SPI_ERROR_WCOL : SPI was busy, transfer is not started
+			
+	Example :
+			
+			void SPI_TxCpltCallback(void)
+			{
+				
+				if (SPI_GetError_IT() != _SPI_ERROR_NONE)
+				{
+					// ...
+				}
+				
+			}
+			
+*/
+
+void SPI_PowerDown(void);
+/*
+	Guide   :
+			Function description	Stop the SPI clock to save power (PRR or PRR0 clock gating on
+									devices with PRSPI, SPI disable on the others). The SPI configuration
+									is kept and restored by SPI_PowerUp. The initialization functions
+									restart the clock. The enable macros (__SPI_ENABLE_IT, ...) can be
+									used in power down, they are applied by SPI_PowerUp.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_PowerDown();
+			
+*/
+
+void SPI_PowerUp(void);
+/*
+	Guide   :
+			Function description	Restart the SPI clock and restore the SPI configuration.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_PowerUp();
+			
+*/
+
+void SPI_RunControl(uint8_t _bits, uint8_t _state);
+/*
+	Guide   :
+			Function description	Set or clear the SPI enable (SPE) and SPI interrupt enable (SPIE) bits,
+									used by the __SPI_ENABLE, __SPI_DISABLE, __SPI_ENABLE_IT and
+									__SPI_DISABLE_IT macros. In power down, the bits are applied by
+									SPI_PowerUp.
+			
+			Parameters
+									* _bits  : (1U << SPE) and/or (1U << SPIE)
+									* _state : 1 to set, 0 to clear
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_RunControl((1U << SPIE), 1);
+			
+*/
+
+void SPI_WaitForComplete_IT(void);
+/*
+	Guide   :
+			Function description	Wait for the end of the interrupt transfer in idle sleep mode. The CPU
+									is woken up by the SPI interrupt. The end of the transfer is tested
+									with interrupts disabled, they are enabled just before the sleep
+									instruction. On CodeVisionAVR the sleep mode bits must select idle
+									(reset value).
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_Transmit_IT(data_for_transmit, 50);
+			SPI_WaitForComplete_IT();
+			
+*/
+
+void SPI_Schedule_IT(SPI_TransactionTypeDef *_trans, SPI_LaneTypeDef _lane);
+/*
+	Guide   :
+			Function description	Queue a transaction in a priority lane. Transactions are started by the
+									SPI interrupt, the highest priority lane first. A higher priority
+									transaction is started at the end of the current transaction. The CS
+									pin of the device stays low and the SPI is not reconfigured between
+									back-to-back transactions of the same device. A transaction queued
+									during another interrupt transfer is started at its end. The SPI
+									interrupt enable bit is not changed.
+			
+			Parameters
+									* _trans : pointer to a SPI_TransactionTypeDef structure (must be kept
+											   while its State is _SPI_TRANSACTION_QUEUED or
+											   _SPI_TRANSACTION_BUSY)
+									* _lane  : priority lane (SPI_LaneTypeDef), the transaction is
+											   not queued if the lane is not valid
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_DeviceTypeDef      imu;
+			SPI_TransactionTypeDef imu_read;
+			
+			imu.Init   = imu_cfg;
+			imu.CSPort = &PORTB;
+			imu.CSPin  = 4;
+			
+			imu_read.Device = &imu;
+			imu_read.TxData = imu_cmd;
+			imu_read.RxData = imu_data;
+			imu_read.Size   = 7;
+			
+			__SPI_ENABLE_IT
+			
+			SPI_Schedule_IT(&imu_read, _SPI_LANE_HIGH);
+			
+			while ((imu_read.State == _SPI_TRANSACTION_QUEUED) || (imu_read.State == _SPI_TRANSACTION_BUSY));
+			
+*/
+
+void SPI_GetLaneStat(SPI_LaneTypeDef _lane, SPI_LaneStatTypeDef *_stat);
+/*
+	Guide   :
+			Function description	Get the statistics of a scheduler lane. The latency time base is
+									_SPI_SCHED_TIMESTAMP() (spi_unit_conf.h).
+			
+			Parameters
+									* _lane : scheduler lane (SPI_LaneTypeDef)
+									* _stat : pointer to a SPI_LaneStatTypeDef structure
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_LaneStatTypeDef imu_stat;
+			
+			SPI_GetLaneStat(_SPI_LANE_HIGH, &imu_stat);
+			
+*/
+
+void SPI_ResetLaneStat(void);
+/*
+	Guide   :
+			Function description	Reset the statistics of all scheduler lanes.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_ResetLaneStat();
+			
+*/
+
+void SPI_SlaveRegMap_IT(uint8_t *_reg_map, uint8_t _size);
+/*
+	Guide   :
+			Function description	Emulate a register map in slave mode with Interrupt. The first byte
+									of each frame is the register address, the bit _SPI_REGMAP_WRITE_BIT
+									of it selects write (1) or read (0). The next bytes are streamed
+									directly from/to the register map with address auto increment. Past
+									the end of the map, _SPI_DUMMY_BYTE (0xFF) is sent and the
+									received data is ignored.
+			
+			Parameters
+									* _reg_map : pointer to register map
+									* _size    : amount of registers in the map
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t registers[16];
+			
+			SPI_DefaultSlaveInit();
+			SPI_SlaveRegMap_IT(registers, 16);
+			
+*/
+
+void SPI_SlaveRegMap_Restart(void);
+/*
+	Guide   :
+			Function description	Wait for a new register address (start of a new frame). Call it
+									when the master releases the SS pin.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_SlaveRegMap_Restart();
+			
+*/
+
+void SPI_SlaveFrame_IT(SPI_FrameTypeDef *_frames, uint8_t _count, uint16_t _size);
+/*
+	Guide   :
+			Function description	Receive SS framed packets of any length in slave mode with Interrupt.
+									The bytes are written directly into a ring of buffers, each packet (SS
+									low to SS high) fills one buffer. Call SPI_SlaveFrame_SSEdge_IT() from
+									the pin change interrupt of the SS pin. A packet is dropped when no
+									buffer is free, data longer than the buffer is ignored.
+			
+			Parameters
+									* _frames : pointer to an array of SPI_FrameTypeDef (Data is set by the user)
+									* _count  : amount of frames in the array (at least 2)
+									* _size   : size of each Data buffer
+									
+			Return Values
+									-
+			
+	Example :
+			
+			uint8_t buffer_a[64], buffer_b[64], buffer_c[64];
+			SPI_FrameTypeDef frames[3] = {{buffer_a}, {buffer_b}, {buffer_c}};
+			
+			SPI_DefaultSlaveInit();
+			SPI_SlaveFrame_IT(frames, 3, 64);
+			
+*/
+
+void SPI_SlaveFrame_SSEdge_IT(void);
+/*
+	Guide   :
+			Function description	Mark a packet boundary. Call it from the pin change interrupt of the
+									SS pin (both edges), the SS level is read from _PIN_SPI. The packet
+									is handed off and the next buffer is armed on the rising edge.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			ISR(PCINT0_vect)
+			{
+				SPI_SlaveFrame_SSEdge_IT();
+			}
+			
+*/
+
+SPI_FrameTypeDef *SPI_SlaveFrame_Get(void);
+/*
+	Guide   :
+			Function description	Get the oldest received packet. The packet buffer is owned by the
+									application until SPI_SlaveFrame_Release() is called.
+			
+			Parameters
+									-
+									
+			Return Values
+									* pointer to the frame (Data, Length) or 0 if no packet is received
+			
+	Example :
+			
+			SPI_FrameTypeDef *packet = SPI_SlaveFrame_Get();
+			
+			if (packet != 0)
+			{
+				Process(packet->Data, packet->Length);
+				SPI_SlaveFrame_Release();
+			}
+			
+*/
+
+void SPI_SlaveFrame_Release(void);
+/*
+	Guide   :
+			Function description	Give the buffer of the packet from SPI_SlaveFrame_Get() back to the
+									receiver.
+			
+			Parameters
+									-
+									
+			Return Values
+									-
+			
+	Example :
+			
+			SPI_SlaveFrame_Release();
+			
+*/
+
 void SPI_TxCpltCallback(void);
 
 /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ End of the program ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
@@ -26,24 +26,68 @@
 /* ------ SPI DDR Register ------ */
 #define _DDR_SPI   DDRB
 
+/* ------ SPI PIN Register ------ */
+#define _PIN_SPI   PINB
+
 /* ---------- SPI Pins ---------- */
 #define _MOSI_PIN  5
 #define _MISO_PIN  6
 #define _SCK_PIN   7
+#define _SS_PIN    4
 
 /* 
 	Guide  :
 			_DDR_SPI  : SPI DDRx Register
+			_PIN_SPI  : SPI PINx Register
 			_MOSI_PIN : SPI MOSI pin number
 			_MISO_PIN : SPI MISO pin number
 			_SCK_PIN  : SPI SCK pin number
+			_SS_PIN   : SPI SS pin number
 			
 	Example:
 			#define _DDR_SPI  DDRB
+			#define _PIN_SPI  PINB
 			
 			#define _MOSI_PIN 5
 			#define _MISO_PIN 6
 			#define _SCK_PIN  7
+			#define _SS_PIN   4
+*/
+
+/* ------ SPI Power Save ------ */
+#define _SPI_POWER_SAVE  0
+
+/* 
+	Guide  :
+			_SPI_POWER_SAVE : 1 = Stop the SPI clock (SPI_PowerDown) after each transfer and restart
+			                      it (SPI_PowerUp) before the next one, 0 = SPI clock is always on
+			
+	Example:
+			#define _SPI_POWER_SAVE  0
+*/
+
+/* ---- SPI Transaction Scheduler ---- */
+#define _SPI_SCHED_TIMESTAMP()  0
+
+/* 
+	Guide  :
+			_SPI_SCHED_TIMESTAMP() : 16-bit time base of the scheduler latency statistics
+			                         (0 = latency statistics are disabled)
+			
+	Example:
+			#define _SPI_SCHED_TIMESTAMP()  TCNT1
+*/
+
+/* ---- SPI Slave Register Map ---- */
+#define _SPI_REGMAP_WRITE_BIT  7
+
+/* 
+	Guide  :
+			_SPI_REGMAP_WRITE_BIT : Bit of the address byte that selects write opcode
+			                        (used by SPI_SlaveRegMap_IT)
+			
+	Example:
+			#define _SPI_REGMAP_WRITE_BIT  7
 */
 
 /* Move this function to your program file */
@@ -0,0 +1,29 @@
+/*
+------------------------------------------------------------------------------
+~ File   : interrupt.h
+~ Brief  : Host replacement of <avr/interrupt.h> for the SPI unit tests
+------------------------------------------------------------------------------
+*/
+
+#ifndef __SPI_EMU_AVR_INTERRUPT_H_
+#define __SPI_EMU_AVR_INTERRUPT_H_
+
+#include <stdint.h>
+
+extern "C"
+{
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define ISR(vect) void vect(void) /* Called by the emulator */
+
+#define sei() SPI_Emu_SetGlobalIT(1)
+#define cli() SPI_Emu_SetGlobalIT(0)
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Prototype ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+void SPI_Emu_SetGlobalIT(uint8_t _state);
+
+void SPI_STC_vect(void);
+
+}
+
+#endif /* __SPI_EMU_AVR_INTERRUPT_H_ */
@@ -0,0 +1,114 @@
+/*
+------------------------------------------------------------------------------
+~ File   : io.h
+~ Brief  : Host replacement of <avr/io.h> for the SPI unit tests
+------------------------------------------------------------------------------
+~ Description:    SPCR, SPSR, SPDR and SREG (I bit) are routed to the register
+                  emulator (spi_emu.cpp), the other registers are plain variables.
+------------------------------------------------------------------------------
+*/
+
+#ifndef __SPI_EMU_AVR_IO_H_
+#define __SPI_EMU_AVR_IO_H_
+
+#include <stdint.h>
+
+extern "C"
+{
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+/* ------ SPCR ------ */
+#define SPIE  7
+#define SPE   6
+#define DORD  5
+#define MSTR  4
+#define CPOL  3
+#define CPHA  2
+#define SPR1  1
+#define SPR0  0
+
+/* ------ SPSR ------ */
+#define SPIF  7
+#define WCOL  6
+#define SPI2X 0
+
+/* ------ SREG ------ */
+#define SREG_I 7
+
+/* ------ PRR ------ */
+#define PRSPI 2
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Enum ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+typedef enum /* Emulated registers */
+{
+	
+	_SPI_EMU_SPCR = 0,
+	_SPI_EMU_SPSR = 1U,
+	_SPI_EMU_SPDR = 2U,
+	_SPI_EMU_SREG = 3U
+	
+}SPI_EmuRegTypeDef;
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Prototype ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+uint8_t SPI_Emu_Read(SPI_EmuRegTypeDef _reg);
+
+void SPI_Emu_Write(SPI_EmuRegTypeDef _reg, uint8_t _value);
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Class ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+class SPI_EmuRegister /* Every access is seen by the emulator */
+{
+	
+	public:
+	
+	explicit SPI_EmuRegister(SPI_EmuRegTypeDef _reg) : reg(_reg) {}
+	
+	operator uint8_t() const
+	{
+		return SPI_Emu_Read(reg);
+	}
+	
+	SPI_EmuRegister &operator=(unsigned int _value) /* Integer promoted values of the driver */
+	{
+		SPI_Emu_Write(reg, (uint8_t)_value);
+		return *this;
+	}
+	
+	SPI_EmuRegister &operator|=(unsigned int _value)
+	{
+		SPI_Emu_Write(reg, (uint8_t)(SPI_Emu_Read(reg) | _value));
+		return *this;
+	}
+	
+	SPI_EmuRegister &operator&=(unsigned int _value)
+	{
+		SPI_Emu_Write(reg, (uint8_t)(SPI_Emu_Read(reg) & _value));
+		return *this;
+	}
+	
+	private:
+	
+	SPI_EmuRegTypeDef reg;
+	
+};
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Variable ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+extern SPI_EmuRegister SPCR;
+extern SPI_EmuRegister SPSR;
+extern SPI_EmuRegister SPDR;
+extern SPI_EmuRegister SREG;
+
+extern volatile uint8_t DDRB;
+extern volatile uint8_t PINB;
+extern volatile uint8_t PORTB;
+extern volatile uint8_t PORTC;
+extern volatile uint8_t g_spi_emu_prr;
+
+#ifdef SPI_EMU_PRR0 /* PRSPI in PRR0 (ATmega644P, ATmega1284P, ...) */
+	#define PRR0 g_spi_emu_prr
+#else
+	#define PRR  g_spi_emu_prr
+#endif /* SPI_EMU_PRR0 */
+
+}
+
+#endif /* __SPI_EMU_AVR_IO_H_ */
@@ -0,0 +1,31 @@
+/*
+------------------------------------------------------------------------------
+~ File   : sleep.h
+~ Brief  : Host replacement of <avr/sleep.h> for the SPI unit tests
+------------------------------------------------------------------------------
+*/
+
+#ifndef __SPI_EMU_AVR_SLEEP_H_
+#define __SPI_EMU_AVR_SLEEP_H_
+
+#include <stdint.h>
+
+extern "C"
+{
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define SLEEP_MODE_IDLE 0
+
+#define set_sleep_mode(mode) ((void)(mode))
+#define sleep_enable()       SPI_Emu_SetSleepEnable(1)
+#define sleep_disable()      SPI_Emu_SetSleepEnable(0)
+#define sleep_cpu()          SPI_Emu_Sleep()
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Prototype ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+void SPI_Emu_SetSleepEnable(uint8_t _state);
+
+void SPI_Emu_Sleep(void);
+
+}
+
+#endif /* __SPI_EMU_AVR_SLEEP_H_ */
@@ -0,0 +1,24 @@
+/*
+------------------------------------------------------------------------------
+~ File   : delay.h
+~ Brief  : Host replacement of <util/delay.h> for the SPI unit tests
+------------------------------------------------------------------------------
+*/
+
+#ifndef __SPI_EMU_UTIL_DELAY_H_
+#define __SPI_EMU_UTIL_DELAY_H_
+
+#include <stdint.h>
+
+extern "C"
+{
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define _delay_ms(x) SPI_Emu_DelayMs(x) /* The emulated time runs during the delay */
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Prototype ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+void SPI_Emu_DelayMs(uint32_t _ms);
+
+}
+
+#endif /* __SPI_EMU_UTIL_DELAY_H_ */
@@ -0,0 +1,483 @@
+/*
+------------------------------------------------------------------------------
+~ File   : spi_emu.cpp
+~ Brief  : AVR SPI register emulator for the host unit tests
+------------------------------------------------------------------------------
+*/
+
+#include "spi_emu.h"
+
+#include "avr/interrupt.h"
+#include "avr/sleep.h"
+#include "util/delay.h"
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define _SPI_EMU_CYCLES_PER_MS  (F_CPU / 1000UL)
+
+#define __SPI_EMU_GATED         ((g_spi_emu_prr & (1U << PRSPI)) != 0)
+#define __SPI_EMU_MASTER        ((g_spi_emu.Spcr & (1U << MSTR)) != 0)
+#define __SPI_EMU_ENABLED       ((g_spi_emu.Spcr & (1U << SPE)) != 0)
+#define __SPI_EMU_IT_PENDING    (((g_spi_emu.Spsr & (1U << SPIF)) != 0) && ((g_spi_emu.Spcr & (1U << SPIE)) != 0) && __SPI_EMU_ENABLED)
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Variable ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+SPI_EmuRegister SPCR(_SPI_EMU_SPCR);
+SPI_EmuRegister SPSR(_SPI_EMU_SPSR);
+SPI_EmuRegister SPDR(_SPI_EMU_SPDR);
+SPI_EmuRegister SREG(_SPI_EMU_SREG);
+
+volatile uint8_t DDRB;
+volatile uint8_t PINB;
+volatile uint8_t PORTB;
+volatile uint8_t PORTC;
+volatile uint8_t g_spi_emu_prr;
+
+SPI_EmuTypeDef g_spi_emu;
+
+static const uint8_t g_spi_emu_divider[8] = {4, 16, 64, 128, 2, 8, 32, 64}; /* SPI2X:SPR1:SPR0 */
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Function ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static uint8_t SPI_Emu_DefaultMiso(void)
+{
+	return 0xA5;
+}
+
+static uint32_t SPI_Emu_ByteCycles(void)
+{
+	
+	uint8_t rate = (uint8_t)((g_spi_emu.Spcr & 3U) | ((g_spi_emu.Spsr & (1U << SPI2X)) << 2));
+	uint32_t cycles = 8UL * g_spi_emu_divider[rate];
+	
+	if (g_spi_emu.SpifDelay != 0)
+	{
+		cycles += g_spi_emu.SpifDelay();
+	}
+	
+	return cycles;
+	
+}
+
+static void SPI_Emu_ClearFlags(void) /* SPDR access after a SPSR read */
+{
+	
+	if (g_spi_emu.FlagRead != 0)
+	{
+		
+		g_spi_emu.Spsr    &= (uint8_t)~((1U << SPIF) | (1U << WCOL));
+		g_spi_emu.FlagRead = 0;
+		
+	}
+	
+}
+
+static void SPI_Emu_Deliver(void)
+{
+	
+	while ((g_spi_emu.GlobalIT != 0) && (g_spi_emu.InIsr == 0) && (g_spi_emu.InHook == 0) && __SPI_EMU_IT_PENDING && !__SPI_EMU_GATED)
+	{
+		
+		/* The interrupt wakes up the CPU, the vector clears SPIF */
+		g_spi_emu.Asleep = 0;
+		g_spi_emu.Spsr  &= (uint8_t)~(1U << SPIF);
+		
+		g_spi_emu.InIsr         = 1;
+		g_spi_emu.GlobalIT      = 0;
+		g_spi_emu.IsrEntryCycle = g_spi_emu.Cycles;
+		g_spi_emu.IsrLoadCycle  = 0;
+		g_spi_emu.IsrCalls++;
+		
+		SPI_STC_vect();
+		
+		g_spi_emu.GlobalIT = 1;
+		g_spi_emu.InIsr    = 0;
+		
+	}
+	
+}
+
+void SPI_Emu_Reset(void)
+{
+	
+	g_spi_emu.Spcr         = 0;
+	g_spi_emu.Spsr         = 0;
+	g_spi_emu.Rx           = 0;
+	g_spi_emu.Shift        = 0;
+	g_spi_emu.Shifting     = 0;
+	g_spi_emu.SlaveClocked = 0;
+	g_spi_emu.Remaining    = 0;
+	g_spi_emu.FlagRead     = 0;
+	g_spi_emu.GlobalIT     = 0;
+	g_spi_emu.InIsr        = 0;
+	g_spi_emu.InHook       = 0;
+	g_spi_emu.SleepEnable  = 0;
+	g_spi_emu.Asleep       = 0;
+	
+	g_spi_emu.Cycles        = 0;
+	g_spi_emu.AwakeCycles   = 0;
+	g_spi_emu.AsleepCycles  = 0;
+	g_spi_emu.SleepEntries  = 0;
+	g_spi_emu.LostWakeups   = 0;
+	g_spi_emu.IsrCalls      = 0;
+	g_spi_emu.Wcol          = 0;
+	g_spi_emu.DelayMs       = 0;
+	g_spi_emu.GatedAccesses = 0;
+	g_spi_emu.SpcrWrites    = 0;
+	g_spi_emu.SpsrWrites    = 0;
+	g_spi_emu.IsrEntryCycle = 0;
+	g_spi_emu.IsrLoadCycle  = 0;
+	
+	g_spi_emu.Mosi.clear();
+	g_spi_emu.Miso.clear();
+	
+	g_spi_emu.MisoSource = SPI_Emu_DefaultMiso;
+	g_spi_emu.SpifDelay  = 0;
+	g_spi_emu.Hook       = 0;
+	
+	DDRB  = 0;
+	PINB  = 0xFF;
+	PORTB = 0xFF;
+	PORTC = 0xFF;
+	g_spi_emu_prr = 0;
+	
+}
+
+void SPI_Emu_Tick(uint32_t _cycles)
+{
+	
+	for (; _cycles > 0; _cycles--)
+	{
+		
+		g_spi_emu.Cycles++;
+		
+		if (g_spi_emu.Asleep != 0)
+		{
+			g_spi_emu.AsleepCycles++;
+		}
+		else
+		{
+			g_spi_emu.AwakeCycles++;
+		}
+		
+		if ((g_spi_emu.Hook != 0) && (g_spi_emu.InHook == 0) && (g_spi_emu.InIsr == 0))
+		{
+			
+			g_spi_emu.InHook = 1;
+			g_spi_emu.Hook();
+			g_spi_emu.InHook = 0;
+			
+		}
+		
+		/* Clock gating stops the SPI, the byte on the bus is lost */
+		if ((g_spi_emu.Shifting != 0) && (g_spi_emu.SlaveClocked == 0) && __SPI_EMU_GATED)
+		{
+			g_spi_emu.Shifting = 0;
+		}
+		
+		/* End of a byte clocked by the SPI */
+		if ((g_spi_emu.Shifting != 0) && (g_spi_emu.SlaveClocked == 0) && (--g_spi_emu.Remaining == 0))
+		{
+			
+			g_spi_emu.Shifting = 0;
+			g_spi_emu.Rx       = g_spi_emu.MisoSource();
+			g_spi_emu.Spsr    |= (1U << SPIF);
+			
+			g_spi_emu.Miso.push_back(g_spi_emu.Rx);
+			
+		}
+		
+		SPI_Emu_Deliver();
+		
+	}
+	
+	SPI_Emu_Deliver();
+	
+}
+
+uint8_t SPI_Emu_Run(uint32_t _max_cycles)
+{
+	
+	for (; (_max_cycles > 0) && ((g_spi_emu.Shifting != 0) || __SPI_EMU_IT_PENDING); _max_cycles--)
+	{
+		SPI_Emu_Tick(1);
+	}
+	
+	return (uint8_t)(g_spi_emu.Shifting == 0);
+	
+}
+
+void SPI_Emu_InjectModf(void)
+{
+	
+	/* SS is driven low by another master: MSTR is cleared and SPIF is set */
+	if (__SPI_EMU_MASTER && __SPI_EMU_ENABLED)
+	{
+		
+		g_spi_emu.Spcr    &= (uint8_t)~(1U << MSTR);
+		g_spi_emu.Spsr    |= (1U << SPIF);
+		g_spi_emu.Shifting = 0;
+		
+		SPI_Emu_Deliver();
+		
+	}
+	
+}
+
+void SPI_Emu_InjectSpurious(void)
+{
+	
+	/* Interrupt without a finished byte */
+	if (g_spi_emu.InIsr == 0)
+	{
+		
+		g_spi_emu.InIsr = 1;
+		g_spi_emu.IsrCalls++;
+		
+		SPI_STC_vect();
+		
+		g_spi_emu.InIsr = 0;
+		
+	}
+	
+}
+
+uint8_t SPI_Emu_MasterByte(uint8_t _mosi)
+{
+	
+	SPI_Emu_MasterBegin();
+	
+	return SPI_Emu_MasterEnd(_mosi);
+	
+}
+
+void SPI_Emu_MasterBegin(void)
+{
+	
+	/* The external master starts to clock a byte */
+	g_spi_emu.Shifting     = 1;
+	g_spi_emu.SlaveClocked = 1;
+	
+}
+
+uint8_t SPI_Emu_MasterEnd(uint8_t _mosi)
+{
+	
+	uint8_t miso = g_spi_emu.Shift;
+	
+	g_spi_emu.Shifting     = 0;
+	g_spi_emu.SlaveClocked = 0;
+	
+	if (__SPI_EMU_ENABLED && !__SPI_EMU_MASTER)
+	{
+		
+		g_spi_emu.Shift = _mosi; /* Sent back if SPDR is not written */
+		g_spi_emu.Rx    = _mosi;
+		g_spi_emu.Spsr |= (1U << SPIF);
+		
+	}
+	
+	SPI_Emu_Tick(1);
+	
+	return miso;
+	
+}
+
+uint16_t SPI_Emu_Timestamp(void)
+{
+	return (uint16_t)g_spi_emu.Cycles;
+}
+
+/* ........................ Registers ........................ */
+
+uint8_t SPI_Emu_Read(SPI_EmuRegTypeDef _reg)
+{
+	
+	uint8_t value = 0;
+	
+	if (_reg == _SPI_EMU_SREG) /* CPU register, not gated */
+	{
+		
+		value = (uint8_t)(g_spi_emu.GlobalIT << SREG_I);
+		SPI_Emu_Tick(1);
+		
+		return value;
+		
+	}
+	
+	if (__SPI_EMU_GATED)
+	{
+		
+		g_spi_emu.GatedAccesses++;
+		SPI_Emu_Tick(1);
+		
+		return 0;
+		
+	}
+	
+	switch (_reg)
+	{
+		
+		case _SPI_EMU_SPCR:
+			
+			value = g_spi_emu.Spcr;
+			
+		break;
+		case _SPI_EMU_SPSR:
+			
+			value = g_spi_emu.Spsr;
+			
+			if ((value & ((1U << SPIF) | (1U << WCOL))) != 0)
+			{
+				g_spi_emu.FlagRead = 1;
+			}
+			
+		break;
+		case _SPI_EMU_SPDR:
+			
+			value = g_spi_emu.Rx;
+			SPI_Emu_ClearFlags();
+			
+		break;
+		default: /* SREG is handled above */
+		break;
+		
+	}
+	
+	SPI_Emu_Tick(1);
+	
+	return value;
+	
+}
+
+void SPI_Emu_Write(SPI_EmuRegTypeDef _reg, uint8_t _value)
+{
+	
+	if (_reg == _SPI_EMU_SREG) /* A pending interrupt is taken after the next instruction */
+	{
+		
+		g_spi_emu.GlobalIT = (uint8_t)((_value >> SREG_I) & 1U);
+		SPI_Emu_Tick(1);
+		
+		return;
+		
+	}
+	
+	if (__SPI_EMU_GATED)
+	{
+		
+		g_spi_emu.GatedAccesses++;
+		SPI_Emu_Tick(1);
+		
+		return;
+		
+	}
+	
+	switch (_reg)
+	{
+		
+		case _SPI_EMU_SPCR:
+			
+			g_spi_emu.Spcr = _value;
+			g_spi_emu.SpcrWrites++;
+			
+		break;
+		case _SPI_EMU_SPSR:
+			
+			g_spi_emu.Spsr = (uint8_t)((g_spi_emu.Spsr & ~(1U << SPI2X)) | (_value & (1U << SPI2X)));
+			g_spi_emu.SpsrWrites++;
+			
+		break;
+		case _SPI_EMU_SPDR:
+			
+			SPI_Emu_ClearFlags();
+			
+			if (g_spi_emu.InIsr != 0 && g_spi_emu.IsrLoadCycle == 0)
+			{
+				g_spi_emu.IsrLoadCycle = g_spi_emu.Cycles;
+			}
+			
+			if (g_spi_emu.Shifting != 0) /* Write collision, the byte is not written */
+			{
+				
+				g_spi_emu.Spsr |= (1U << WCOL);
+				g_spi_emu.Wcol++;
+				
+			}
+			else if (__SPI_EMU_ENABLED)
+			{
+				
+				g_spi_emu.Shift = _value;
+				
+				if (__SPI_EMU_MASTER) /* Start of a byte */
+				{
+					
+					g_spi_emu.Shifting  = 1;
+					g_spi_emu.Remaining = SPI_Emu_ByteCycles();
+					
+					g_spi_emu.Mosi.push_back(_value);
+					
+				}
+				
+			}
+			
+		break;
+		default: /* SREG is handled above */
+		break;
+		
+	}
+	
+	SPI_Emu_Tick(1);
+	
+}
+
+/* ........................... CPU ........................... */
+
+void SPI_Emu_SetGlobalIT(uint8_t _state)
+{
+	g_spi_emu.GlobalIT = _state; /* A pending interrupt is taken after the next instruction */
+}
+
+void SPI_Emu_SetSleepEnable(uint8_t _state)
+{
+	g_spi_emu.SleepEnable = _state;
+}
+
+void SPI_Emu_Sleep(void)
+{
+	
+	if (g_spi_emu.SleepEnable == 0)
+	{
+		return;
+	}
+	
+	g_spi_emu.SleepEntries++;
+	g_spi_emu.Asleep = 1;
+	
+	SPI_Emu_Deliver(); /* A pending interrupt wakes up the CPU at once */
+	
+	while (g_spi_emu.Asleep != 0)
+	{
+		
+		if ((g_spi_emu.GlobalIT == 0) || ((g_spi_emu.Shifting == 0) && !__SPI_EMU_IT_PENDING))
+		{
+			
+			/* Nothing can wake up the CPU */
+			g_spi_emu.LostWakeups++;
+			g_spi_emu.Asleep = 0;
+			
+		}
+		else
+		{
+			SPI_Emu_Tick(1);
+		}
+		
+	}
+	
+}
+
+void SPI_Emu_DelayMs(uint32_t _ms)
+{
+	
+	g_spi_emu.DelayMs += _ms;
+	
+	SPI_Emu_Tick(_ms * _SPI_EMU_CYCLES_PER_MS);
+	
+}
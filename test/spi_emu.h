@@ -0,0 +1,95 @@
+/*
+------------------------------------------------------------------------------
+~ File   : spi_emu.h
+~ Brief  : AVR SPI register emulator for the host unit tests
+------------------------------------------------------------------------------
+~ Description:    Emulates SPCR, SPSR and SPDR of an AVR SPI (SPIF/WCOL clear
+                  sequence, write collision, mode fault, PRR clock gating) and
+                  the SPI interrupt (global interrupt flag, idle sleep). The time
+                  base is one CPU cycle, every register access takes one cycle.
+
+~ Attention  :    The SPI driver is compiled as C++ against the fake headers
+                  in emu/ so that register accesses are seen by the emulator.
+------------------------------------------------------------------------------
+*/
+
+#ifndef __SPI_EMU_H_
+#define __SPI_EMU_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "avr/io.h"
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Struct ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+typedef struct /* Emulator state and statistics */
+{
+	
+	/* ------ Registers ------ */
+	uint8_t Spcr;
+	uint8_t Spsr;
+	uint8_t Rx;               /* Receive buffer (SPDR read) */
+	uint8_t Shift;            /* Byte in the shift register */
+	
+	/* ------ Transfer ------ */
+	uint8_t  Shifting;        /* A byte is on the bus */
+	uint8_t  SlaveClocked;    /* The byte is clocked by the external master */
+	uint32_t Remaining;       /* Cycles to the end of the byte (master) */
+	uint8_t  FlagRead;        /* SPSR was read with SPIF or WCOL set */
+	
+	/* ------ CPU ------ */
+	uint8_t GlobalIT;         /* I bit of SREG */
+	uint8_t InIsr;
+	uint8_t InHook;
+	uint8_t SleepEnable;
+	uint8_t Asleep;
+	
+	/* ------ Statistics ------ */
+	uint32_t Cycles;
+	uint32_t AwakeCycles;
+	uint32_t AsleepCycles;
+	uint32_t SleepEntries;
+	uint32_t LostWakeups;     /* Sleep without a wake up source */
+	uint32_t IsrCalls;
+	uint32_t Wcol;
+	uint32_t DelayMs;
+	uint32_t GatedAccesses;   /* Register accesses while PRSPI is set */
+	uint32_t SpcrWrites;
+	uint32_t SpsrWrites;
+	uint32_t IsrEntryCycle;
+	uint32_t IsrLoadCycle;    /* First SPDR write of the last interrupt */
+	
+	/* ------ Bus logs ------ */
+	std::vector<uint8_t> Mosi; /* Bytes sent by the master (driver in master mode) */
+	std::vector<uint8_t> Miso; /* Bytes received by the master (driver in master mode) */
+	
+	/* ------ Injection ------ */
+	uint8_t  (*MisoSource)(void);  /* Next byte of the slave */
+	uint32_t (*SpifDelay)(void);   /* Extra cycles of a byte */
+	void     (*Hook)(void);        /* Called every cycle out of the interrupt, runs like another interrupt (the SPI interrupt is not nested) */
+	
+}SPI_EmuTypeDef;
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Variable ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+extern SPI_EmuTypeDef g_spi_emu;
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Prototype ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+void SPI_Emu_Reset(void);
+
+void SPI_Emu_Tick(uint32_t _cycles);
+
+uint8_t SPI_Emu_Run(uint32_t _max_cycles);
+
+void SPI_Emu_InjectModf(void);
+
+void SPI_Emu_InjectSpurious(void);
+
+uint8_t SPI_Emu_MasterByte(uint8_t _mosi);
+
+void SPI_Emu_MasterBegin(void);
+
+uint8_t SPI_Emu_MasterEnd(uint8_t _mosi);
+
+extern "C" uint16_t SPI_Emu_Timestamp(void);
+
+#endif /* __SPI_EMU_H_ */
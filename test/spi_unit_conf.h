@@ -0,0 +1,33 @@
+/*
+------------------------------------------------------------------------------
+~ File   : spi_unit_conf.h
+~ Brief  : SPI unit configuration of the host unit tests
+------------------------------------------------------------------------------
+~ Description:    Replaces SPI_UNIT-V0.0.0/spi_unit_conf.h in the test build.
+                  SPI_TxCpltCallback is defined by the test program.
+------------------------------------------------------------------------------
+*/
+
+#ifndef __SPI_UNIT_CONF_H_
+#define __SPI_UNIT_CONF_H_
+
+/* ~~~~~~~~~~~~~~~~~~~~ Configuration ~~~~~~~~~~~~~~~~~~~~ */
+
+/* ------ SPI DDR Register ------ */
+#define _DDR_SPI   DDRB
+
+/* ---------- SPI Pins ---------- */
+#define _MOSI_PIN  5
+#define _MISO_PIN  6
+#define _SCK_PIN   7
+
+/* _PIN_SPI, _SS_PIN, _SPI_POWER_SAVE and _SPI_REGMAP_WRITE_BIT are left to the
+   defaults of spi_unit.h (_SPI_POWER_SAVE is set by the build) */
+
+/* ---- SPI Transaction Scheduler ---- */
+#define _SPI_SCHED_TIMESTAMP()  SPI_Emu_Timestamp()
+
+uint16_t SPI_Emu_Timestamp(void);
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#endif /* __SPI_UNIT_CONF_H_ */
@@ -0,0 +1,1606 @@
+/*
+------------------------------------------------------------------------------
+~ File   : spi_unit_test.cpp
+~ Brief  : Host unit tests of the SPI unit
+------------------------------------------------------------------------------
+~ Description:    Every test runs the driver against the register emulator and
+                  checks the bus and the completion against a reference model.
+
+~ Attention  :    spi_unit_test <name> runs one test, spi_unit_test runs all.
+------------------------------------------------------------------------------
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "spi_unit.h"
+#include "spi_emu.h"
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Defines ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+#define __TEST_CHECK(cond) {if (!(cond)) {printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); g_test_failures++;}}
+
+#define _TEST_RUN_CYCLES    2000000UL
+#define _TEST_FUZZ_ROUNDS   3000U
+#define _TEST_BUFFER_SIZE   32U
+#define _TEST_NO_MODF       0xFFFFU
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Struct ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+typedef struct /* Named test */
+{
+	
+	const char *Name;
+	void       (*Run)(void);
+	
+}Test_CaseTypeDef;
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Variable ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static uint32_t g_test_failures  = 0;
+static uint32_t g_test_callbacks = 0;
+static uint32_t g_test_seed      = 1;
+
+static SPI_InitTypeDef g_test_cfg;
+
+static uint16_t g_test_modf_at   = _TEST_NO_MODF; /* Byte index of the injected mode fault */
+static uint8_t  g_test_rearm     = 0;             /* Re-arm attempts in the hook */
+static uint32_t g_test_rearms    = 0;
+static uint8_t  g_test_miso_next = 0;
+
+static uint8_t g_test_junk[_TEST_BUFFER_SIZE];
+
+static uint32_t g_test_sched_writes[_TEST_BUFFER_SIZE]; /* SPCR + SPSR writes when a MOSI byte is first seen */
+static uint32_t g_test_sched_cs_high = 0;               /* Cycles with the CS pin of the high lane device released */
+static uint8_t  g_test_sched_first   = 0;               /* MOSI bytes before the high lane transactions */
+static uint8_t  g_test_sched_last    = 0;               /* MOSI bytes at the end of the high lane transactions */
+
+static SPI_ChainTypeDef *g_test_chain        = 0;
+static uint32_t         g_test_chain_at      = 0;    /* Cycle of the commit from a timer interrupt */
+static uint8_t          g_test_chain_result  = 0xFF; /* Return value of the commit from the timer interrupt */
+static uint32_t         g_test_latches       = 0;    /* Latch pulses */
+static uint32_t         g_test_latch_sent    = 0;    /* MOSI bytes at the last latch pulse */
+static uint8_t          g_test_latch_busy    = 0;    /* A byte was on the bus at a latch pulse */
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Function ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+void SPI_TxCpltCallback(void)
+{
+	g_test_callbacks++;
+}
+
+static uint32_t Test_Random(void) /* xorshift32 */
+{
+	
+	g_test_seed ^= g_test_seed << 13;
+	g_test_seed ^= g_test_seed >> 17;
+	g_test_seed ^= g_test_seed << 5;
+	
+	return g_test_seed;
+	
+}
+
+static uint8_t Test_RandomMiso(void)
+{
+	return (uint8_t)Test_Random();
+}
+
+static uint8_t Test_CountMiso(void)
+{
+	return g_test_miso_next++;
+}
+
+static uint32_t Test_RandomDelay(void)
+{
+	return Test_Random() % 97U;
+}
+
+static void Test_Hook(void)
+{
+	
+	/* Mode fault while a byte is on the bus */
+	if ((g_test_modf_at != _TEST_NO_MODF) && (g_spi_emu.Shifting != 0) && (g_spi_emu.Mosi.size() == (size_t)g_test_modf_at + 1U))
+	{
+		
+		g_test_modf_at = _TEST_NO_MODF;
+		SPI_Emu_InjectModf();
+		
+		return;
+		
+	}
+	
+	/* Re-arm while busy from another interrupt, every start must be rejected */
+	if ((g_test_rearm != 0) && (g_spi_emu.GlobalIT != 0) && (g_spi_emu.Shifting != 0) && ((Test_Random() % 8U) == 0))
+	{
+		
+		g_test_rearms++;
+		
+		switch (Test_Random() % 6U)
+		{
+			
+			case 0: SPI_Transmit_IT(g_test_junk, 4); break;
+			case 1: SPI_Receive_IT(g_test_junk, 4); break;
+			case 2: SPI_TransmitReceive_IT(g_test_junk, g_test_junk, 4); break;
+			case 3: SPI_TransmitReceiveWord_IT(g_test_junk, g_test_junk, 2, _SPI_WORDSIZE_16BIT, _SPI_BYTEORDER_MSB); break;
+			case 4: SPI_FillColor_IT(0x1234, 3); break;
+			default: SPI_TransmitPixels_IT(g_test_junk, 2, 1, 6); break;
+			
+		}
+		
+	}
+	
+}
+
+static void Test_Setup(SPI_ModeTypeDef _mode)
+{
+	
+	SPI_Emu_Reset();
+	
+	g_test_cfg.Mode           = _mode;
+	g_test_cfg.FirstBit       = _SPI_FIRSTBIT_MSB;
+	g_test_cfg.ClockPhase     = _SPI_CLOCKPHASE_FIRSTEDGE;
+	g_test_cfg.ClockPolarity  = _SPI_CLOCKPOLARITY_LOW;
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_16;
+	
+	SPI_Init(&g_test_cfg);
+	
+	__SPI_ENABLE
+	__SPI_ENABLE_IT
+	sei();
+	
+	g_test_callbacks = 0;
+	g_test_modf_at   = _TEST_NO_MODF;
+	g_test_rearm     = 0;
+	g_test_rearms    = 0;
+	g_test_miso_next = 0x10;
+	
+	g_spi_emu.Hook = Test_Hook;
+	
+	(void)SPI_GetError_IT();
+	
+}
+
+static void Test_ClearLogs(void)
+{
+	
+	g_spi_emu.Mosi.clear();
+	g_spi_emu.Miso.clear();
+	
+	g_spi_emu.Wcol   = 0;
+	g_test_callbacks = 0;
+	
+}
+
+static uint8_t Test_MosiIs(const uint8_t *_data, uint16_t _size)
+{
+	return (uint8_t)((g_spi_emu.Mosi.size() == _size) && ((_size == 0) || (memcmp(g_spi_emu.Mosi.data(), _data, _size) == 0)));
+}
+
+/* ............................ Tests ............................ */
+
+static void Test_Fuzz(void)
+{
+	
+	static const SPI_CLKRateTypeDef rates[] = {_SPI_CLOCKRATE_FCPU_2, _SPI_CLOCKRATE_FCPU_4, _SPI_CLOCKRATE_FCPU_8, _SPI_CLOCKRATE_FCPU_16,
+	                                           _SPI_CLOCKRATE_FCPU_32, _SPI_CLOCKRATE_FCPU_64, _SPI_CLOCKRATE_FCPU_128};
+	
+	uint8_t  tx[_TEST_BUFFER_SIZE];
+	uint8_t  rx[_TEST_BUFFER_SIZE];
+	uint16_t round;
+	uint16_t size;
+	uint16_t modf_at;
+	uint16_t index;
+	uint8_t  receive;
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	
+	g_spi_emu.MisoSource = Test_RandomMiso;
+	g_spi_emu.SpifDelay  = Test_RandomDelay;
+	g_test_rearm         = 1;
+	
+	for (round = 0; round < _TEST_FUZZ_ROUNDS; round++)
+	{
+		
+		/* Random configuration */
+		g_test_cfg.ClockFrequency = rates[Test_Random() % 7U];
+		SPI_ReConfig(&g_test_cfg);
+		
+		size    = (uint16_t)(Test_Random() % 20U);
+		receive = (uint8_t)(Test_Random() & 1U);
+		modf_at = ((size > 0) && ((Test_Random() % 8U) == 0)) ? (uint16_t)(Test_Random() % size) : _TEST_NO_MODF;
+		
+		for (index = 0; index < _TEST_BUFFER_SIZE; index++)
+		{
+			
+			tx[index] = (uint8_t)Test_Random();
+			rx[index] = 0;
+			
+		}
+		
+		/* Spurious interrupt while the bus is idle */
+		if ((Test_Random() % 4U) == 0)
+		{
+			SPI_Emu_InjectSpurious();
+		}
+		
+		Test_ClearLogs();
+		g_test_modf_at = modf_at;
+		
+		if (receive != 0)
+		{
+			SPI_TransmitReceive_IT(tx, rx, size);
+		}
+		else
+		{
+			SPI_Transmit_IT(tx, size);
+		}
+		
+		__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+		
+		/* Reference model */
+		if (size == 0)
+		{
+			
+			__TEST_CHECK(g_spi_emu.Mosi.empty());
+			__TEST_CHECK(g_test_callbacks == 0);
+			__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+			
+		}
+		else if (modf_at != _TEST_NO_MODF)
+		{
+			
+			/* Bytes up to the fault are sent, the bytes before it are received */
+			__TEST_CHECK(Test_MosiIs(tx, (uint16_t)(modf_at + 1U)));
+			__TEST_CHECK(g_test_callbacks == 1);
+			__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_MODF);
+			
+			if (receive != 0)
+			{
+				__TEST_CHECK((modf_at == 0) || (memcmp(rx, g_spi_emu.Miso.data(), modf_at) == 0));
+			}
+			
+			/* Back to master mode */
+			SPI_ReConfig(&g_test_cfg);
+			
+		}
+		else
+		{
+			
+			__TEST_CHECK(Test_MosiIs(tx, size));
+			__TEST_CHECK(g_test_callbacks == 1);
+			__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+			__TEST_CHECK(g_spi_emu.Wcol == 0);
+			
+			if (receive != 0)
+			{
+				__TEST_CHECK((g_spi_emu.Miso.size() == size) && (memcmp(rx, g_spi_emu.Miso.data(), size) == 0));
+			}
+			
+		}
+		
+		__TEST_CHECK(rx[size] == 0); /* No write after the buffer */
+		
+		if (g_test_failures != 0)
+		{
+			
+			printf("fuzz: round %u, size %u, modf at %u\n", round, size, modf_at);
+			return;
+			
+		}
+		
+	}
+	
+	__TEST_CHECK(g_test_rearms > 0);
+	
+	printf("fuzz: %u rounds, %u re-arm attempts rejected\n", _TEST_FUZZ_ROUNDS, (unsigned)g_test_rearms);
+	
+}
+
+static void Test_ZeroLength(void)
+{
+	
+	uint8_t data[4] = {1, 2, 3, 4};
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	SPI_Transmit_IT(data, 0);
+	SPI_TransmitReceive_IT(data, data, 0);
+	SPI_Receive_IT(data, 0);
+	SPI_TransmitReceiveWord_IT(data, data, 0, _SPI_WORDSIZE_16BIT, _SPI_BYTEORDER_MSB);
+	SPI_FillColor_IT(0x1234, 0);
+	SPI_TransmitPixels_IT(data, 0, 1, 0);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(g_spi_emu.Mosi.empty());
+	__TEST_CHECK(g_test_callbacks == 0);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+	
+	/* The driver is not left busy */
+	SPI_Transmit_IT(data, 2);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(Test_MosiIs(data, 2));
+	__TEST_CHECK(g_test_callbacks == 1);
+	
+}
+
+static void Test_TransmitReceiveOrder(void)
+{
+	
+	uint8_t tx[8] = {0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87};
+	uint8_t rx[9] = {0};
+	uint8_t index;
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	g_spi_emu.MisoSource = Test_CountMiso;
+	
+	SPI_TransmitReceive_IT(tx, rx, 8);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(Test_MosiIs(tx, 8));
+	
+	/* rx[i] is the byte clocked in with tx[i] */
+	for (index = 0; index < 8; index++)
+	{
+		__TEST_CHECK(rx[index] == (uint8_t)(0x10 + index));
+	}
+	
+	__TEST_CHECK(rx[8] == 0);
+	__TEST_CHECK(g_test_callbacks == 1);
+	
+}
+
+static void Test_Modf(void)
+{
+	
+	uint8_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	g_test_modf_at = 3;
+	
+	SPI_Transmit_IT(data, 8);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(Test_MosiIs(data, 4));
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_MODF);
+	__TEST_CHECK((g_spi_emu.Spcr & (1U << MSTR)) == 0);
+	
+	/* The same configuration must restore the master mode */
+	SPI_ReConfig(&g_test_cfg);
+	Test_ClearLogs();
+	
+	SPI_Transmit_IT(data, 2);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(Test_MosiIs(data, 2));
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+	__TEST_CHECK((g_spi_emu.Spcr & (1U << MSTR)) != 0);
+	
+}
+
+static void Test_Wcol(void)
+{
+	
+	uint8_t data[3] = {1, 2, 3};
+	
+	/* Master: a byte written out of the driver is on the bus */
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	SPDR = 0x55;
+	SPI_Transmit_IT(data, 3);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(Test_MosiIs((const uint8_t *)"\x55", 1));
+	__TEST_CHECK(g_spi_emu.Wcol == 1);
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_WCOL);
+	
+	/* The next transfer is started */
+	Test_ClearLogs();
+	
+	SPI_Transmit_IT(data, 3);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(Test_MosiIs(data, 3));
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+	
+	/* Slave: the master is clocking a byte */
+	Test_Setup(_SPI_MODE_SLAVE);
+	
+	SPI_Emu_MasterBegin();
+	SPI_TransmitReceive_IT(data, data, 3);
+	
+	__TEST_CHECK(g_spi_emu.Wcol == 1);
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_WCOL);
+	
+	(void)SPI_Emu_MasterEnd(0);
+	
+	__TEST_CHECK(g_test_callbacks == 1); /* The byte is ignored */
+	
+}
+
+static void Test_RearmBusy(void)
+{
+	
+	uint8_t tx[6] = {9, 8, 7, 6, 5, 4};
+	uint8_t rx[6];
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	g_spi_emu.SpifDelay = Test_RandomDelay;
+	g_test_rearm        = 1;
+	
+	SPI_TransmitReceive_IT(tx, rx, 6);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(g_test_rearms > 0);
+	__TEST_CHECK(Test_MosiIs(tx, 6));
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+	
+}
+
+static void Test_Spurious(void)
+{
+	
+	uint8_t data[2] = {1, 2};
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	SPI_Emu_InjectSpurious();
+	
+	__TEST_CHECK(g_spi_emu.Mosi.empty());
+	__TEST_CHECK(g_test_callbacks == 0);
+	
+	SPI_Transmit_IT(data, 2);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	
+	SPI_Emu_InjectSpurious();
+	SPI_Emu_InjectSpurious();
+	
+	__TEST_CHECK(Test_MosiIs(data, 2));
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+	
+}
+
+static void Test_ScheduleAbort(void)
+{
+	
+	uint8_t data_a[4] = {0xA0, 0xA1, 0xA2, 0xA3};
+	uint8_t data_b[3] = {0xB0, 0xB1, 0xB2};
+	
+	SPI_DeviceTypeDef      dev_a;
+	SPI_DeviceTypeDef      dev_b;
+	SPI_TransactionTypeDef trans_a;
+	SPI_TransactionTypeDef trans_b;
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	dev_a.Init   = g_test_cfg;
+	dev_a.CSPort = &PORTB;
+	dev_a.CSPin  = 0;
+	
+	dev_b.Init                = g_test_cfg;
+	dev_b.Init.ClockFrequency = _SPI_CLOCKRATE_FCPU_4;
+	dev_b.CSPort              = &PORTC;
+	dev_b.CSPin               = 1;
+	
+	trans_a.Device = &dev_a;
+	trans_a.TxData = data_a;
+	trans_a.RxData = 0;
+	trans_a.Size   = 4;
+	
+	trans_b.Device = &dev_b;
+	trans_b.TxData = data_b;
+	trans_b.RxData = 0;
+	trans_b.Size   = 3;
+	
+	g_test_modf_at = 1;
+	
+	SPI_Schedule_IT(&trans_a, _SPI_LANE_NORMAL);
+	SPI_Schedule_IT(&trans_b, _SPI_LANE_NORMAL);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	
+	/* A is aborted, B is started after the abort */
+	__TEST_CHECK(trans_a.State == _SPI_TRANSACTION_ABORTED);
+	__TEST_CHECK(trans_b.State == _SPI_TRANSACTION_DONE);
+	__TEST_CHECK((g_spi_emu.Mosi.size() == 5) && (memcmp(g_spi_emu.Mosi.data() + 2, data_b, 3) == 0));
+	__TEST_CHECK((PORTB & 1U) != 0);
+	__TEST_CHECK((PORTC & 2U) != 0);
+	__TEST_CHECK(g_test_callbacks == 2);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_MODF);
+	
+}
+
+static void Test_RegMap(void)
+{
+	
+	uint8_t  map[16];
+	uint8_t  miso;
+	uint16_t index;
+	uint32_t latency;
+	
+	for (index = 0; index < 16; index++)
+	{
+		map[index] = (uint8_t)(0x40 + index);
+	}
+	
+	Test_Setup(_SPI_MODE_SLAVE);
+	
+	SPI_SlaveRegMap_IT(map, 16);
+	
+	/* Read from register 2: the response must be loaded before the next byte */
+	__TEST_CHECK(SPI_Emu_MasterByte(0x02) == 0xFF);
+	
+	latency = g_spi_emu.IsrLoadCycle - g_spi_emu.IsrEntryCycle;
+	
+	__TEST_CHECK(g_spi_emu.IsrLoadCycle != 0);
+	__TEST_CHECK(SPI_Emu_MasterByte(0) == 0x42);
+	
+	printf("regmap: first response loaded %u emulator cycles after the interrupt entry\n", (unsigned)latency);
+	
+	/* A long read stops at the end of the map (the index must not wrap) */
+	SPI_SlaveRegMap_Restart();
+	
+	__TEST_CHECK(SPI_Emu_MasterByte(0x00) == 0xFF);
+	
+	for (index = 0; index < 300; index++)
+	{
+		
+		miso = SPI_Emu_MasterByte(0);
+		
+		__TEST_CHECK(miso == ((index < 16) ? map[index] : 0xFF));
+		
+	}
+	
+	/* A long write stops at the end of the map */
+	SPI_SlaveRegMap_Restart();
+	
+	(void)SPI_Emu_MasterByte(0x80 | 0x0E);
+	
+	for (index = 0; index < 300; index++)
+	{
+		(void)SPI_Emu_MasterByte((uint8_t)index);
+	}
+	
+	__TEST_CHECK((map[14] == 0) && (map[15] == 1));
+	
+	for (index = 0; index < 14; index++)
+	{
+		__TEST_CHECK(map[index] == (uint8_t)(0x40 + index));
+	}
+	
+	__TEST_CHECK(g_test_callbacks == 0);
+	
+}
+
+static void Test_PowerInit(void)
+{
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	
+	/* Initialization while the SPI clock is stopped */
+	SPI_PowerDown();
+	
+	__TEST_CHECK((g_spi_emu_prr & (1U << PRSPI)) != 0);
+	
+	g_spi_emu.GatedAccesses   = 0;
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_4;
+	
+	SPI_Init(&g_test_cfg);
+	
+	__TEST_CHECK((g_spi_emu_prr & (1U << PRSPI)) == 0);
+	__TEST_CHECK(g_spi_emu.GatedAccesses == 0);
+	__TEST_CHECK(g_spi_emu.Spcr == (1U << MSTR));
+	
+	/* The new configuration is not replaced by the saved one */
+	SPI_PowerUp();
+	
+	__TEST_CHECK(g_spi_emu.Spcr == (1U << MSTR));
+	
+	SPI_PowerDown();
+	SPI_DefaultSlaveInit();
+	
+	__TEST_CHECK((g_spi_emu_prr & (1U << PRSPI)) == 0);
+	__TEST_CHECK(g_spi_emu.Spcr == (1U << SPE));
+	
+	SPI_PowerDown();
+	SPI_DefaultMasterInit();
+	
+	__TEST_CHECK((g_spi_emu_prr & (1U << PRSPI)) == 0);
+	__TEST_CHECK(g_spi_emu.Spcr == ((1U << SPE) | (1U << MSTR) | (1U << SPR0)));
+	
+	/* De-initialization keeps a real register image */
+	SPI_PowerDown();
+	SPI_DeInit();
+	
+	__TEST_CHECK((g_spi_emu_prr & (1U << PRSPI)) == 0);
+	__TEST_CHECK(g_spi_emu.Spcr == 0);
+	
+	SPI_PowerDown();
+	SPI_PowerUp();
+	
+	__TEST_CHECK(g_spi_emu.Spcr == 0);
+	__TEST_CHECK(g_spi_emu.GatedAccesses == 0);
+	
+}
+
+static void Test_Sleep(void)
+{
+	
+	uint8_t  data[32];
+	uint32_t awake;
+	uint32_t asleep;
+	
+	memset(data, 0x3C, sizeof(data));
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_128;
+	SPI_ReConfig(&g_test_cfg);
+	
+	g_spi_emu.SpifDelay = Test_RandomDelay;
+	
+	/* Interrupt transfer, the CPU sleeps until the end */
+	awake  = g_spi_emu.AwakeCycles;
+	asleep = g_spi_emu.AsleepCycles;
+	
+	SPI_Transmit_IT(data, sizeof(data));
+	SPI_WaitForComplete_IT();
+	
+	awake  = g_spi_emu.AwakeCycles - awake;
+	asleep = g_spi_emu.AsleepCycles - asleep;
+	
+	__TEST_CHECK(Test_MosiIs(data, sizeof(data)));
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(g_spi_emu.LostWakeups == 0);
+	__TEST_CHECK(g_spi_emu.SleepEntries > 0);
+	__TEST_CHECK(asleep > awake);
+	
+	printf("sleep: %u bytes, %u idle sleep entries, %u cycles awake, %u cycles asleep\n", (unsigned)sizeof(data),
+	       (unsigned)g_spi_emu.SleepEntries, (unsigned)awake, (unsigned)asleep);
+	
+	/* Nothing to wait for: no sleep */
+	g_spi_emu.SleepEntries = 0;
+	
+	SPI_WaitForComplete_IT();
+	
+	__TEST_CHECK(g_spi_emu.SleepEntries == 0);
+	__TEST_CHECK(g_spi_emu.LostWakeups == 0);
+	
+	/* Blocking transfer of the same data for comparison */
+	__SPI_DISABLE_IT
+	
+	awake = g_spi_emu.AwakeCycles;
+	
+	SPI_Transmit(data, sizeof(data), 100);
+	
+	printf("sleep: blocking transfer, %u cycles awake\n", (unsigned)(g_spi_emu.AwakeCycles - awake));
+	
+}
+
+static void Test_ScheduleBusy(void)
+{
+	
+	uint8_t data[4] = {0x11, 0x22, 0x33, 0x44};
+	uint8_t cmd[2]  = {0xC0, 0xC1};
+	
+	SPI_DeviceTypeDef      dev;
+	SPI_TransactionTypeDef trans;
+	SPI_TransactionTypeDef invalid;
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	dev.Init   = g_test_cfg;
+	dev.CSPort = &PORTB;
+	dev.CSPin  = 0;
+	
+	trans.Device = &dev;
+	trans.TxData = cmd;
+	trans.RxData = 0;
+	trans.Size   = 2;
+	
+	/* Queued during a transfer that is not scheduled */
+	SPI_Transmit_IT(data, 4);
+	SPI_Schedule_IT(&trans, _SPI_LANE_LOW);
+	
+	__TEST_CHECK(trans.State == _SPI_TRANSACTION_QUEUED);
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(trans.State == _SPI_TRANSACTION_DONE);
+	__TEST_CHECK((g_spi_emu.Mosi.size() == 6) && (memcmp(g_spi_emu.Mosi.data(), data, 4) == 0) && (memcmp(g_spi_emu.Mosi.data() + 4, cmd, 2) == 0));
+	__TEST_CHECK((PORTB & 1U) != 0);
+	__TEST_CHECK(g_test_callbacks == 2);
+	
+	/* The SPI interrupt enable bit is restored, not forced */
+	Test_ClearLogs();
+	
+	__SPI_DISABLE_IT
+	
+	SPI_Schedule_IT(&trans, _SPI_LANE_HIGH);
+	
+	__TEST_CHECK((g_spi_emu.Spcr & (1U << SPIE)) == 0);
+	
+	__SPI_ENABLE_IT
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(trans.State == _SPI_TRANSACTION_DONE);
+	__TEST_CHECK(Test_MosiIs(cmd, 2));
+	
+	/* Invalid lane */
+	Test_ClearLogs();
+	
+	invalid       = trans;
+	invalid.State = _SPI_TRANSACTION_DONE;
+	
+	SPI_Schedule_IT(&invalid, _SPI_LANE_COUNT);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(invalid.State == _SPI_TRANSACTION_DONE);
+	__TEST_CHECK(g_spi_emu.Mosi.empty());
+	__TEST_CHECK(g_test_callbacks == 0);
+	
+}
+
+static uint32_t Test_StallDelay(void)
+{
+	return 0x7FFFFFFFUL; /* The byte never ends */
+}
+
+static void Test_FillColor(void)
+{
+	
+	uint32_t index;
+	uint8_t  ok = 1;
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	__SPI_DISABLE_IT
+	
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_2;
+	SPI_ReConfig(&g_test_cfg);
+	
+	/* Full frame, the timeout is not used up by the frame */
+	SPI_FillColor(0xF81F, 320UL * 240UL, 1);
+	
+	__TEST_CHECK(g_spi_emu.Mosi.size() == 2UL * 320UL * 240UL);
+	
+	for (index = 0; (index < g_spi_emu.Mosi.size()) && (ok != 0); index++)
+	{
+		ok = (uint8_t)(g_spi_emu.Mosi[index] == (((index & 1U) == 0) ? 0xF8 : 0x1F));
+	}
+	
+	__TEST_CHECK(ok != 0);
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_spi_emu.DelayMs == 0);
+	
+	printf("fill: %u bytes in %u cycles\n", (unsigned)g_spi_emu.Mosi.size(), (unsigned)g_spi_emu.Cycles);
+	
+	/* Stalled bus: stopped after the timeout of the first byte, no write collision */
+	Test_ClearLogs();
+	
+	g_spi_emu.SpifDelay = Test_StallDelay;
+	
+	SPI_FillColor(0xF81F, 100, 3);
+	
+	__TEST_CHECK(g_spi_emu.Mosi.size() == 1);
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_spi_emu.DelayMs == 3);
+	
+}
+
+static void Test_Pixels(void)
+{
+	
+	static uint8_t frame[8][16][3];
+	
+	uint16_t x;
+	uint16_t y;
+	uint16_t color;
+	size_t   byte = 0;
+	uint8_t  ok   = 1;
+	
+	for (y = 0; y < 8; y++)
+	{
+		
+		for (x = 0; x < 16; x++)
+		{
+			
+			frame[y][x][0] = (uint8_t)Test_Random();
+			frame[y][x][1] = (uint8_t)Test_Random();
+			frame[y][x][2] = (uint8_t)Test_Random();
+			
+		}
+		
+	}
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	__SPI_DISABLE_IT
+	
+	/* Window x = 3, y = 2, 5 x 4 pixels */
+	SPI_TransmitPixels(&frame[2][3][0], 5, 4, 16, 1);
+	
+	__TEST_CHECK(g_spi_emu.Mosi.size() == 2U * 5U * 4U);
+	
+	for (y = 2; (y < 6) && (g_spi_emu.Mosi.size() == 40U); y++)
+	{
+		
+		for (x = 3; x < 8; x++)
+		{
+			
+			color = __SPI_RGB565(frame[y][x][0], frame[y][x][1], frame[y][x][2]);
+			
+			ok &= (uint8_t)(g_spi_emu.Mosi[byte] == (uint8_t)(color >> 8));
+			ok &= (uint8_t)(g_spi_emu.Mosi[byte + 1] == (uint8_t)color);
+			
+			byte += 2;
+			
+		}
+		
+	}
+	
+	__TEST_CHECK(ok != 0);
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_spi_emu.DelayMs == 0);
+	
+	/* Stalled bus */
+	Test_ClearLogs();
+	
+	g_spi_emu.SpifDelay = Test_StallDelay;
+	
+	SPI_TransmitPixels(&frame[0][0][0], 16, 8, 16, 2);
+	
+	__TEST_CHECK(g_spi_emu.Mosi.size() == 1);
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_spi_emu.DelayMs == 2);
+	
+}
+
+static void Test_Word(void)
+{
+	
+	uint32_t tx[100];
+	uint32_t rx[101];
+	uint16_t index;
+	uint8_t  ok = 1;
+	
+	for (index = 0; index < 100; index++)
+	{
+		
+		tx[index] = Test_Random() & 0x00FFFFFFUL;
+		rx[index] = 0xFFFFFFFFUL;
+		
+	}
+	
+	rx[100] = 0;
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	__SPI_DISABLE_IT
+	
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_2;
+	SPI_ReConfig(&g_test_cfg);
+	
+	g_spi_emu.MisoSource = Test_RandomMiso;
+	
+	/* 24-bit words, most significant byte first */
+	SPI_TransmitReceiveWord(tx, rx, 100, _SPI_WORDSIZE_24BIT, _SPI_BYTEORDER_MSB, 1);
+	
+	__TEST_CHECK((g_spi_emu.Mosi.size() == 300) && (g_spi_emu.Miso.size() == 300));
+	
+	for (index = 0; (index < 100) && (g_spi_emu.Mosi.size() == 300); index++)
+	{
+		
+		ok &= (uint8_t)(g_spi_emu.Mosi[index * 3U] == (uint8_t)(tx[index] >> 16));
+		ok &= (uint8_t)(g_spi_emu.Mosi[index * 3U + 1U] == (uint8_t)(tx[index] >> 8));
+		ok &= (uint8_t)(g_spi_emu.Mosi[index * 3U + 2U] == (uint8_t)tx[index]);
+		ok &= (uint8_t)(rx[index] == (((uint32_t)g_spi_emu.Miso[index * 3U] << 16) | ((uint32_t)g_spi_emu.Miso[index * 3U + 1U] << 8) | g_spi_emu.Miso[index * 3U + 2U]));
+		
+	}
+	
+	__TEST_CHECK(ok != 0);
+	__TEST_CHECK(rx[100] == 0);
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_spi_emu.DelayMs == 0);
+	
+	/* Stalled bus: stopped after the timeout of the first byte, no write collision */
+	Test_ClearLogs();
+	
+	g_spi_emu.SpifDelay = Test_StallDelay;
+	
+	SPI_TransmitWord(tx, 100, _SPI_WORDSIZE_16BIT, _SPI_BYTEORDER_LSB, 4);
+	
+	__TEST_CHECK(g_spi_emu.Mosi.size() == 1);
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_spi_emu.DelayMs == 4);
+	
+}
+
+static void Test_FramePacket(const char *_data, uint8_t _delayed_first)
+{
+	
+	/* SS falling edge */
+	PINB &= (uint8_t)~(1U << _SS_PIN);
+	
+	if (_delayed_first != 0) /* The SS interrupt is taken before the SPI interrupt of the first byte */
+	{
+		
+		SPI_Emu_SetGlobalIT(0);
+		
+		(void)SPI_Emu_MasterByte((uint8_t)*_data);
+		_data++;
+		
+		SPI_SlaveFrame_SSEdge_IT();
+		
+		SPI_Emu_SetGlobalIT(1);
+		
+	}
+	else
+	{
+		SPI_SlaveFrame_SSEdge_IT();
+	}
+	
+	for (; *_data != 0; _data++)
+	{
+		(void)SPI_Emu_MasterByte((uint8_t)*_data);
+	}
+	
+	/* SS rising edge */
+	PINB |= (1U << _SS_PIN);
+	
+	SPI_SlaveFrame_SSEdge_IT();
+	
+}
+
+static uint8_t Test_FrameIs(const char *_data)
+{
+	
+	SPI_FrameTypeDef *frame = SPI_SlaveFrame_Get();
+	uint8_t          ok;
+	
+	ok = (uint8_t)((frame != 0) && (frame->Length == strlen(_data)) && (memcmp(frame->Data, _data, frame->Length) == 0));
+	
+	if (frame != 0)
+	{
+		SPI_SlaveFrame_Release();
+	}
+	
+	return ok;
+	
+}
+
+static void Test_SlaveFrame(void)
+{
+	
+	uint8_t buffer[3][8];
+	
+	SPI_FrameTypeDef frames[3] = {{buffer[0], 0}, {buffer[1], 0}, {buffer[2], 0}};
+	
+	Test_Setup(_SPI_MODE_SLAVE);
+	
+	SPI_SlaveFrame_IT(frames, 3, 8);
+	
+	/* The first byte is not lost when its interrupt comes after the SS edge */
+	Test_FramePacket("hi", 1);
+	Test_FramePacket("abcdefghij", 0); /* Longer than the buffer */
+	Test_FramePacket("xyz", 1);         /* No free buffer, dropped */
+	
+	__TEST_CHECK(Test_FrameIs("hi"));
+	__TEST_CHECK(Test_FrameIs("abcdefgh"));
+	__TEST_CHECK(SPI_SlaveFrame_Get() == 0);
+	
+	Test_FramePacket("q", 1);
+	Test_FramePacket("rs", 0);
+	
+	__TEST_CHECK(Test_FrameIs("q"));
+	__TEST_CHECK(Test_FrameIs("rs"));
+	__TEST_CHECK(SPI_SlaveFrame_Get() == 0);
+	__TEST_CHECK(g_test_callbacks == 0);
+	
+}
+
+static void Test_ReConfig(void)
+{
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	
+	/* Identical configuration, no register is written */
+	g_spi_emu.SpcrWrites = 0;
+	g_spi_emu.SpsrWrites = 0;
+	
+	SPI_ReConfig(&g_test_cfg);
+	
+	__TEST_CHECK(g_spi_emu.SpcrWrites == 0);
+	__TEST_CHECK(g_spi_emu.SpsrWrites == 0);
+	
+	/* Rate change of SPI2X only (same SPR bits), one SPSR write */
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_8;
+	
+	SPI_ReConfig(&g_test_cfg);
+	
+	__TEST_CHECK(g_spi_emu.SpcrWrites == 0);
+	__TEST_CHECK(g_spi_emu.SpsrWrites == 1);
+	__TEST_CHECK((g_spi_emu.Spsr & (1U << SPI2X)) != 0);
+	
+	/* Mode change, one SPCR write and the enable bits are kept */
+	g_test_cfg.ClockPolarity = _SPI_CLOCKPOLARITY_HIGH;
+	
+	SPI_ReConfig(&g_test_cfg);
+	
+	__TEST_CHECK(g_spi_emu.SpcrWrites == 1);
+	__TEST_CHECK(g_spi_emu.SpsrWrites == 1);
+	__TEST_CHECK(g_spi_emu.Spcr == ((1U << SPIE) | (1U << SPE) | (1U << MSTR) | (1U << CPOL) | (1U << SPR0)));
+	
+	/* FCPU_2 -> FCPU_4 clears SPI2X through SPI_Init */
+	g_test_cfg.ClockPolarity  = _SPI_CLOCKPOLARITY_LOW;
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_2;
+	
+	SPI_Init(&g_test_cfg);
+	
+	__TEST_CHECK((g_spi_emu.Spsr & (1U << SPI2X)) != 0);
+	
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_4;
+	
+	SPI_Init(&g_test_cfg);
+	
+	__TEST_CHECK((g_spi_emu.Spsr & (1U << SPI2X)) == 0);
+	__TEST_CHECK((g_spi_emu.Spcr & ((1U << SPR1) | (1U << SPR0))) == 0);
+	
+	/* FCPU_2 -> FCPU_4 clears SPI2X through SPI_ReConfig */
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_2;
+	
+	SPI_ReConfig(&g_test_cfg);
+	
+	__TEST_CHECK((g_spi_emu.Spsr & (1U << SPI2X)) != 0);
+	
+	g_spi_emu.SpcrWrites      = 0;
+	g_spi_emu.SpsrWrites      = 0;
+	g_test_cfg.ClockFrequency = _SPI_CLOCKRATE_FCPU_4;
+	
+	SPI_ReConfig(&g_test_cfg);
+	
+	__TEST_CHECK(g_spi_emu.SpcrWrites == 0);
+	__TEST_CHECK(g_spi_emu.SpsrWrites == 1);
+	__TEST_CHECK((g_spi_emu.Spsr & (1U << SPI2X)) == 0);
+	__TEST_CHECK((g_spi_emu.Spcr & ((1U << SPR1) | (1U << SPR0))) == 0);
+	
+}
+
+/* The rate selection is folded at compile time (F_CPU = 8 MHz) */
+static_assert(__SPI_CLOCKRATE_SELECT(4000000UL) == _SPI_CLOCKRATE_FCPU_2, "rate selection is not constant");
+static_assert(__SPI_CLOCKRATE_FREQ(_SPI_CLOCKRATE_FCPU_128) == 62500UL, "rate frequency is not constant");
+
+static uint8_t g_test_rate_folded[__SPI_CLOCKRATE_FREQ(__SPI_CLOCKRATE_SELECT(100000UL)) / 62500UL]; /* Array size of 1 */
+
+static void Test_ClockRate(void)
+{
+	
+	static const SPI_CLKRateTypeDef rates[7] =
+	{
+		_SPI_CLOCKRATE_FCPU_2,  _SPI_CLOCKRATE_FCPU_4,  _SPI_CLOCKRATE_FCPU_8, _SPI_CLOCKRATE_FCPU_16,
+		_SPI_CLOCKRATE_FCPU_32, _SPI_CLOCKRATE_FCPU_64, _SPI_CLOCKRATE_FCPU_128
+	};
+	
+	uint8_t index;
+	
+	__TEST_CHECK(sizeof(g_test_rate_folded) == 1);
+	
+	/* Boundaries */
+	__TEST_CHECK(__SPI_CLOCKRATE_SELECT(4000000UL) == _SPI_CLOCKRATE_FCPU_2);
+	__TEST_CHECK(__SPI_CLOCKRATE_SELECT(3999000UL) == _SPI_CLOCKRATE_FCPU_4);
+	__TEST_CHECK(__SPI_CLOCKRATE_SELECT(62500UL)   == _SPI_CLOCKRATE_FCPU_128);
+	__TEST_CHECK(__SPI_CLOCKRATE_SELECT(62499UL)   == _SPI_CLOCKRATE_FCPU_128);
+	__TEST_CHECK(__SPI_CLOCKRATE_SELECT(1000UL)    == _SPI_CLOCKRATE_FCPU_128);
+	
+	__TEST_CHECK(SPI_GetClockRate(4000000UL) == _SPI_CLOCKRATE_FCPU_2);
+	__TEST_CHECK(SPI_GetClockRate(3999000UL) == _SPI_CLOCKRATE_FCPU_4);
+	__TEST_CHECK(SPI_GetClockRate(62500UL)   == _SPI_CLOCKRATE_FCPU_128);
+	__TEST_CHECK(SPI_GetClockRate(62499UL)   == _SPI_CLOCKRATE_FCPU_128);
+	__TEST_CHECK(SPI_GetClockRate(1000UL)    == _SPI_CLOCKRATE_FCPU_128);
+	
+	/* Every rate, frequency and selection of its own frequency */
+	for (index = 0; index < 7; index++)
+	{
+		
+		uint32_t freq = (F_CPU >> (index + 1));
+		
+		__TEST_CHECK(__SPI_CLOCKRATE_FREQ(rates[index]) == freq);
+		__TEST_CHECK(SPI_GetClockFrequency(rates[index]) == freq);
+		__TEST_CHECK(SPI_GetClockRate(freq) == rates[index]);
+		__TEST_CHECK(SPI_GetClockRate(freq - 1) == rates[(index < 6) ? (index + 1) : 6]);
+		
+	}
+	
+}
+
+static void Test_PowerEnable(void)
+{
+	
+	uint8_t data[3] = {0x11, 0x22, 0x33};
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	
+	/* Interrupt enable bit changed after a blocking transfer (powered down with _SPI_POWER_SAVE = 1) */
+	__SPI_DISABLE_IT
+	
+	SPI_Transmit(data, 3, 10);
+	
+	__SPI_ENABLE_IT
+	
+	Test_ClearLogs();
+	
+	SPI_Transmit_IT(data, 3);
+	
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES) && (g_test_callbacks == 1));
+	__TEST_CHECK(Test_MosiIs(data, 3));
+	
+	SPI_WaitForComplete_IT(); /* Returns at once, the transfer is not busy */
+	
+	__TEST_CHECK(g_spi_emu.LostWakeups == 0);
+	
+	/* Bits changed in an explicit power down are applied by SPI_PowerUp */
+	SPI_PowerDown();
+	
+	__SPI_DISABLE_IT
+	__SPI_DISABLE
+	
+	__TEST_CHECK(g_spi_emu.GatedAccesses == 0);
+	
+	SPI_PowerUp();
+	
+	__TEST_CHECK((g_spi_emu.Spcr & ((1U << SPE) | (1U << SPIE))) == 0);
+	
+	SPI_PowerDown();
+	
+	__SPI_ENABLE
+	__SPI_ENABLE_IT
+	
+	SPI_PowerUp();
+	
+	__TEST_CHECK((g_spi_emu.Spcr & ((1U << SPE) | (1U << SPIE))) == ((1U << SPE) | (1U << SPIE)));
+	__TEST_CHECK(g_spi_emu.GlobalIT != 0);
+	
+}
+
+static void Test_ScheduleHook(void)
+{
+	
+	uint8_t sent = (uint8_t)g_spi_emu.Mosi.size();
+	
+	if ((sent < _TEST_BUFFER_SIZE) && (g_test_sched_writes[sent] == 0xFFFFFFFFUL))
+	{
+		g_test_sched_writes[sent] = g_spi_emu.SpcrWrites + g_spi_emu.SpsrWrites;
+	}
+	
+	if ((sent > g_test_sched_first) && (sent <= g_test_sched_last) && ((PORTC & 2U) != 0))
+	{
+		g_test_sched_cs_high++;
+	}
+	
+}
+
+static void Test_ScheduleLanes(void)
+{
+	
+	uint8_t data_l1[3] = {0x10, 0x11, 0x12};
+	uint8_t data_h1[2] = {0x20, 0x21};
+	uint8_t data_h2[2] = {0x30, 0x31};
+	uint8_t data_l2[2] = {0x40, 0x41};
+	uint8_t expected[9];
+	uint8_t index;
+	
+	SPI_DeviceTypeDef      dev_low;
+	SPI_DeviceTypeDef      dev_high;
+	SPI_TransactionTypeDef trans_l1;
+	SPI_TransactionTypeDef trans_h1;
+	SPI_TransactionTypeDef trans_h2;
+	SPI_TransactionTypeDef trans_l2;
+	SPI_LaneStatTypeDef    stat[_SPI_LANE_COUNT];
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	SPI_ResetLaneStat();
+	
+	dev_low.Init   = g_test_cfg;
+	dev_low.CSPort = &PORTB;
+	dev_low.CSPin  = 0;
+	
+	dev_high.Init                = g_test_cfg;
+	dev_high.Init.ClockFrequency = _SPI_CLOCKRATE_FCPU_2; /* SPR and SPI2X changed */
+	dev_high.CSPort              = &PORTC;
+	dev_high.CSPin               = 1;
+	
+	trans_l1.Device = &dev_low;
+	trans_l1.TxData = data_l1;
+	trans_l1.RxData = 0;
+	trans_l1.Size   = 3;
+	
+	trans_h1.Device = &dev_high;
+	trans_h1.TxData = data_h1;
+	trans_h1.RxData = 0;
+	trans_h1.Size   = 2;
+	
+	trans_h2        = trans_h1;
+	trans_h2.TxData = data_h2;
+	
+	trans_l2        = trans_l1;
+	trans_l2.TxData = data_l2;
+	trans_l2.Size   = 2;
+	
+	memset(g_test_sched_writes, 0xFF, sizeof(g_test_sched_writes));
+	
+	g_test_sched_cs_high = 0;
+	g_test_sched_first   = 3;
+	g_test_sched_last    = 7;
+	g_spi_emu.Hook       = Test_ScheduleHook;
+	
+	/* The low lane starts on an idle bus, the others are queued during its first byte */
+	SPI_Schedule_IT(&trans_l1, _SPI_LANE_LOW);
+	SPI_Schedule_IT(&trans_l2, _SPI_LANE_LOW);
+	SPI_Schedule_IT(&trans_h1, _SPI_LANE_HIGH);
+	SPI_Schedule_IT(&trans_h2, _SPI_LANE_HIGH);
+	
+	__TEST_CHECK(trans_l1.State == _SPI_TRANSACTION_BUSY);
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	
+	/* Priority is applied at the transaction boundaries */
+	memcpy(expected,     data_l1, 3);
+	memcpy(expected + 3, data_h1, 2);
+	memcpy(expected + 5, data_h2, 2);
+	memcpy(expected + 7, data_l2, 2);
+	
+	__TEST_CHECK(Test_MosiIs(expected, 9));
+	__TEST_CHECK((trans_l1.State == _SPI_TRANSACTION_DONE) && (trans_h1.State == _SPI_TRANSACTION_DONE));
+	__TEST_CHECK((trans_h2.State == _SPI_TRANSACTION_DONE) && (trans_l2.State == _SPI_TRANSACTION_DONE));
+	__TEST_CHECK(g_test_callbacks == 4);
+	
+	/* The device is reconfigured when it changes, not between back-to-back transactions */
+	__TEST_CHECK(g_test_sched_writes[4] - g_test_sched_writes[3] == 2); /* L1 -> H1: SPCR and SPSR */
+	__TEST_CHECK(g_test_sched_writes[6] - g_test_sched_writes[5] == 0); /* H1 -> H2 */
+	__TEST_CHECK(g_test_sched_writes[8] - g_test_sched_writes[7] == 2); /* H2 -> L2 */
+	
+	/* CS of the high lane device stays low from H1 to H2, all are released at the end */
+	__TEST_CHECK(g_test_sched_cs_high == 0);
+	__TEST_CHECK(((PORTB & 1U) != 0) && ((PORTC & 2U) != 0));
+	
+	/* Lane statistics */
+	for (index = 0; index < _SPI_LANE_COUNT; index++)
+	{
+		
+		SPI_GetLaneStat((SPI_LaneTypeDef)index, &stat[index]);
+		
+		printf("lane %u: completed %u, max latency %u, average latency %lu cycles\n", index, stat[index].Completed, stat[index].MaxLatency,
+		       (stat[index].Completed != 0) ? (unsigned long)(stat[index].TotalLatency / stat[index].Completed) : 0UL);
+		
+	}
+	
+	__TEST_CHECK(stat[_SPI_LANE_HIGH].Completed == 2);
+	__TEST_CHECK(stat[_SPI_LANE_NORMAL].Completed == 0);
+	__TEST_CHECK(stat[_SPI_LANE_LOW].Completed == 2);
+	__TEST_CHECK(stat[_SPI_LANE_LOW].MaxLatency > stat[_SPI_LANE_HIGH].MaxLatency);
+	
+	SPI_ResetLaneStat();
+	SPI_GetLaneStat(_SPI_LANE_LOW, &stat[_SPI_LANE_LOW]);
+	
+	__TEST_CHECK((stat[_SPI_LANE_LOW].Completed == 0) && (stat[_SPI_LANE_LOW].MaxLatency == 0) && (stat[_SPI_LANE_LOW].TotalLatency == 0));
+	
+}
+
+static void Test_ChainLatch(void)
+{
+	
+	/* Latch pulse (rising then falling edge), the pin is set again to see the next one */
+	if ((*g_test_chain->LatchPort & (1U << g_test_chain->LatchPin)) == 0)
+	{
+		
+		g_test_latches++;
+		g_test_latch_sent = (uint32_t)g_spi_emu.Mosi.size();
+		g_test_latch_busy |= g_spi_emu.Shifting;
+		
+		*g_test_chain->LatchPort |= (1U << g_test_chain->LatchPin);
+		
+	}
+	
+}
+
+static void Test_ChainHook(void)
+{
+	
+	Test_ChainLatch();
+	
+	/* Commit from a timer interrupt (taken only with the global interrupt enabled) */
+	if ((g_test_chain_result == 0xFF) && (g_spi_emu.Cycles >= g_test_chain_at) && (g_spi_emu.GlobalIT != 0))
+	{
+		g_test_chain_result = SPI_Chain_Commit_IT(g_test_chain);
+	}
+	
+}
+
+static void Test_ChainSetup(SPI_ChainTypeDef *_chain, uint8_t *_image, uint16_t _size)
+{
+	
+	Test_Setup(_SPI_MODE_MASTER);
+	
+	_chain->Image     = _image;
+	_chain->Size      = _size;
+	_chain->LatchPort = &PORTC;
+	_chain->LatchPin  = 3;
+	_chain->Dirty     = 1;
+	
+	PORTC |= (1U << 3);
+	
+	g_test_chain        = _chain;
+	g_test_chain_at     = 0xFFFFFFFFUL;
+	g_test_chain_result = 0xFF;
+	g_test_latches      = 0;
+	g_test_latch_sent   = 0;
+	g_test_latch_busy   = 0;
+	g_spi_emu.Hook      = Test_ChainHook;
+	
+}
+
+static void Test_ChainRace(void)
+{
+	
+	uint8_t image[4] = {0xE0, 0xE1, 0xE2, 0xE3};
+	uint8_t data[3]  = {0xD0, 0xD1, 0xD2};
+	uint8_t offset;
+	
+	SPI_ChainTypeDef chain;
+	
+	/* The timer interrupt commits the chain at every cycle of the start of another transfer */
+	for (offset = 0; offset < 24; offset++)
+	{
+		
+		Test_ChainSetup(&chain, image, 4);
+		
+		__SPI_DISABLE_IT
+		
+		SPI_Transmit(data, 1, 10); /* Powered down with _SPI_POWER_SAVE = 1, SPI_PowerUp is in the race */
+		
+		__SPI_ENABLE_IT
+		
+		Test_ClearLogs();
+		
+		g_test_chain_at = g_spi_emu.Cycles + offset;
+		
+		SPI_Transmit_IT(data, 3);
+		
+		__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+		__TEST_CHECK(g_test_chain_result != 0xFF);
+		
+		Test_ChainLatch(); /* Pulse of the last interrupt */
+		
+		/* One of the transfers owns the SPI, the other is rejected */
+		__TEST_CHECK(g_spi_emu.Wcol == 0);
+		__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+		__TEST_CHECK(g_test_callbacks == 1);
+		
+		if (g_test_chain_result != 0) /* Chain first, the transfer of the main loop is rejected */
+		{
+			
+			__TEST_CHECK(Test_MosiIs(image, 4));
+			__TEST_CHECK((g_test_latches == 1) && (chain.Dirty == 0));
+			
+		}
+		else
+		{
+			
+			__TEST_CHECK(Test_MosiIs(data, 3));
+			__TEST_CHECK((g_test_latches == 0) && (chain.Dirty == 1));
+			
+		}
+		
+		if (g_test_failures != 0)
+		{
+			
+			printf("chain_race: offset %u\n", offset);
+			return;
+			
+		}
+		
+	}
+	
+}
+
+static void Test_Chain(void)
+{
+	
+	uint8_t image[4]    = {0x00, 0x00, 0x00, 0x00};
+	uint8_t expected[4] = {0x81, 0x02, 0xA5, 0x00};
+	
+	SPI_ChainTypeDef chain;
+	
+	Test_ChainSetup(&chain, image, 4);
+	Test_ClearLogs();
+	
+	__SPI_DISABLE_IT
+	
+	/* An unchanged chain is not sent */
+	chain.Dirty = 0;
+	
+	__TEST_CHECK(SPI_Chain_Commit_IT(&chain) == 0);
+	__TEST_CHECK(SPI_Chain_Commit(&chain, 10) == 1);
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	__TEST_CHECK(g_spi_emu.Mosi.empty() && (g_test_latches == 0) && (g_test_callbacks == 0));
+	
+	/* Dirty only on a change */
+	SPI_Chain_WriteBit(&chain, 9, 0);
+	SPI_Chain_WriteByte(&chain, 3, 0x00);
+	
+	__TEST_CHECK(chain.Dirty == 0);
+	
+	SPI_Chain_WriteBit(&chain, 9, 1);
+	
+	__TEST_CHECK((chain.Dirty == 1) && (image[1] == 0x02));
+	
+	chain.Dirty = 0;
+	
+	SPI_Chain_WriteBit(&chain, 9, 1);
+	
+	__TEST_CHECK(chain.Dirty == 0);
+	
+	SPI_Chain_WriteByte(&chain, 2, 0xA5);
+	
+	__TEST_CHECK((chain.Dirty == 1) && (image[2] == 0xA5));
+	
+	SPI_Chain_WriteBit(&chain, 0, 1);
+	SPI_Chain_WriteBit(&chain, 7, 1);
+	
+	__TEST_CHECK(memcmp(image, expected, 4) == 0);
+	
+	/* Blocking commit, Image[0] is shifted first and the outputs are latched once */
+	__TEST_CHECK(SPI_Chain_Commit(&chain, 10) == 1);
+	
+	Test_ChainLatch();
+	
+	__TEST_CHECK(Test_MosiIs(expected, 4));
+	__TEST_CHECK((g_test_latches == 1) && (g_test_latch_sent == 4) && (chain.Dirty == 0));
+	
+	/* Interrupt commit, the latch pin is pulsed after the end of the last byte */
+	Test_ClearLogs();
+	
+	__SPI_ENABLE_IT
+	
+	g_test_latches = 0;
+	
+	SPI_Chain_WriteBit(&chain, 31, 1);
+	
+	expected[3] = 0x80;
+	
+	__TEST_CHECK(SPI_Chain_Commit_IT(&chain) == 1);
+	__TEST_CHECK(chain.Dirty == 0);
+	__TEST_CHECK(SPI_Chain_Commit_IT(&chain) == 0); /* Unchanged */
+	__TEST_CHECK(SPI_Emu_Run(_TEST_RUN_CYCLES));
+	
+	Test_ChainLatch();
+	
+	__TEST_CHECK(Test_MosiIs(expected, 4));
+	__TEST_CHECK((g_test_latches == 1) && (g_test_latch_sent == 4) && (g_test_latch_busy == 0));
+	__TEST_CHECK(g_test_callbacks == 1);
+	__TEST_CHECK(SPI_GetError_IT() == _SPI_ERROR_NONE);
+	
+}
+
+static void Test_ChainStall(void)
+{
+	
+	uint8_t image[3] = {0x31, 0x32, 0x33};
+	
+	SPI_ChainTypeDef chain;
+	
+	Test_ChainSetup(&chain, image, 3);
+	Test_ClearLogs();
+	
+	__SPI_DISABLE_IT
+	
+	/* The first byte never ends */
+	g_spi_emu.SpifDelay = Test_StallDelay;
+	
+	__TEST_CHECK(SPI_Chain_Commit(&chain, 3) == 0);
+	
+	Test_ChainLatch();
+	
+	__TEST_CHECK(g_spi_emu.Mosi.size() == 1);
+	__TEST_CHECK(g_spi_emu.Wcol == 0);
+	__TEST_CHECK(g_spi_emu.DelayMs == 3);
+	__TEST_CHECK(g_test_latches == 0);
+	__TEST_CHECK(chain.Dirty == 1);
+	
+	/* The image is sent again by the next commit when the bus is back */
+	Test_Setup(_SPI_MODE_MASTER);
+	Test_ClearLogs();
+	
+	__SPI_DISABLE_IT
+	
+	g_spi_emu.Hook = Test_ChainHook;
+	
+	__TEST_CHECK(SPI_Chain_Commit(&chain, 3) == 1);
+	
+	Test_ChainLatch();
+	
+	__TEST_CHECK(Test_MosiIs(image, 3));
+	__TEST_CHECK((g_test_latches == 1) && (chain.Dirty == 0));
+	
+}
+
+/* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ Main ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
+static const Test_CaseTypeDef g_test_cases[] =
+{
+	
+	{"fuzz",                   Test_Fuzz},
+	{"zero_length",            Test_ZeroLength},
+	{"transmit_receive_order", Test_TransmitReceiveOrder},
+	{"modf",                   Test_Modf},
+	{"wcol",                   Test_Wcol},
+	{"rearm_busy",             Test_RearmBusy},
+	{"spurious",               Test_Spurious},
+	{"schedule_abort",         Test_ScheduleAbort},
+	{"regmap",                 Test_RegMap},
+	{"init_power_down",        Test_PowerInit},
+	{"sleep",                  Test_Sleep},
+	{"schedule_busy",          Test_ScheduleBusy},
+	{"fill_color",             Test_FillColor},
+	{"pixels",                 Test_Pixels},
+	{"word",                   Test_Word},
+	{"slave_frame",            Test_SlaveFrame},
+	{"reconfig",               Test_ReConfig},
+	{"clock_rate",             Test_ClockRate},
+	{"power_enable",           Test_PowerEnable},
+	{"schedule_lanes",         Test_ScheduleLanes},
+	{"chain_race",             Test_ChainRace},
+	{"chain",                  Test_Chain},
+	{"chain_stall",            Test_ChainStall}
+	
+};
+
+int main(int argc, char **argv)
+{
+	
+	uint8_t index;
+	uint8_t found = 0;
+	
+	for (index = 0; index < (sizeof(g_test_cases) / sizeof(g_test_cases[0])); index++)
+	{
+		
+		if ((argc < 2) || (strcmp(argv[1], g_test_cases[index].Name) == 0))
+		{
+			
+			g_test_cases[index].Run();
+			found = 1;
+			
+		}
+		
+	}
+	
+	if (found == 0)
+	{
+		
+		printf("unknown test: %s\n", argv[1]);
+		return 2;
+		
+	}
+	
+	printf("%s\n", (g_test_failures == 0) ? "PASS" : "FAIL");
+	
+	return (g_test_failures == 0) ? 0 : 1;
+	
+}